@@ -1,18 +1,42 @@
 #include <algorithm>
 #include <array>
+#include <cctype>
+#include <atomic>
 #include <cassert>
 #include <ctime>
 #include <functional>
 #include <iostream>
 #include <iterator>
 #include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
 #include <numeric>
 #include <queue>
 #include <random>
 #include <sstream>
+#include <string>
 #include <unordered_map>
+#include <unordered_set>
+#include <thread>
 #include <vector>
 #include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#if defined(__unix__) || defined(__APPLE__)
+#define HEX_HAVE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 using namespace std::chrono;
 using namespace std;
 
@@ -22,9 +46,45 @@ Author:
 Licensing provisions:
  Apache 2.0 license.*/
  // Compile with
- // g++ -Wall -Wextra -Wpedantic -Wconversion HexAI.cpp -o HexAI
+ // g++ -Wall -Wextra -Wpedantic -Wconversion -pthread HexAI.cpp -o HexAI
+ // Add -DHEX_DEBUG_CHECKS to check the bitboard playouts against UnionFind
  // Execute with
- // ./HexAI dimension HumanVsHuman
+ // ./HexAI dimension HumanVsHuman [--threads N] [--seed S]
+ // ./HexAI --size N [--human-vs-human] [--player x|o] [--trials N] (no prompts, N from 4 to 128)
+ //   [--engine flat|mcts|rave] [--uct-c C] [--tree-nodes N] [--rave-k K] [--rave-depth D]
+ //   [--tt-mb MB] (transposition table of the tree search, 0 disables it, default 64 MB,
+ //     4 MB per engine in match and analyze)
+ //   [--move-time MS | --game-time MS --inc MS] (time budget instead of simulations)
+ //   [--ponder] (tree engines search while the human is thinking)
+ //   [--kernel bitboard|sliced|bridges] (flat Monte Carlo playouts one by one, 64 at once,
+ //     or one by one in turn with the bridges kept)
+ //   [--prune] (flat Monte Carlo skips dead, captured and dominated cells)
+ //   [--allocation uniform|halving] (flat Monte Carlo budget over all cells or halved per round)
+ //   [--telemetry stderr|FILE] [--telemetry-top K] (JSON lines per machine move and per game)
+ //   [--book FILE] (opening book, {size} in FILE stands for the dimension)
+ //   [--solve-empties E] [--solve-nodes N] [--solve-ms MS] [--solve-mb MB] (proof-number
+ //     search once at most E cells are blank, a proven win is played at once; with a time
+ //     budget the solver gets at most half of the move and the search the rest)
+ // --threads defaults to the hardware concurrency
+ // Cycles per playout benchmark with
+ // ./HexAI bench-playouts dimension playouts
+ // Fixed positions and seed, total playouts per second for regression tracking
+ // ./HexAI bench [--trials N] [--seed S]
+ // Time of construction, UnionFind, MonteCarlo and display_game at sizes 5 to 64
+ // ./HexAI microbench [--trials N]
+ // Winners of N random tables per size (default 6400) by every kernel against UnionFind
+ // ./HexAI selftest [--trials N] [--seed S]
+ // Exact outcome of a position, rows of . X O, with node count and nodes/s
+ // ./HexAI solve POSITION [--to-move x|o] [--solve-nodes N] [--solve-ms MS] [--solve-mb MB]
+ // Positions of a file or stdin ('-'), one per line as for solve with an optional x|o, searched
+ // by a pool of workers, JSON lines in input order with the value of every cell
+ // ./HexAI analyze FILE|- [--workers N] [--window W] [--trials N]
+ // Opening book of one size, searched to P plies (default 2) with N simulations (default 100000)
+ // ./HexAI build-book dimension [--book FILE] [--book-plies P] [--trials N]
+ // Headless engine for GUIs and match runners (HTP commands on stdin, same engine options)
+ // ./HexAI htp [--size N] [--trials N]
+ // Self-play match, --a-X / --b-X set option X for one engine only (threads default to 1)
+ // ./HexAI match [--games N] [--size N] [--concurrency N] [--sprt --elo0 E --elo1 E --alpha A --beta B]
  /*
     Human can play against human if second argument > 0.
     Machine chooses positions in the hex table and computes best move from
@@ -36,29 +96,38 @@ Licensing provisions:
     The human might want to play in first or
     take machine position.
     Machine might want to take human position if the latest plays first.
-    3 classes:
+    Classes:
     Class Graph.
+    Class BitBoard used to decide the winner of filled tables in playouts.
     Class Hex child class of Graph.
     Functor class gen_shift used to generate integers.
     Player should hit row number enter button,
     then column enter.
  */
+// Content of one cell of the hex table, one byte per cell
+enum class Cell : unsigned char { Blank = 0, Blue = 1, Red = 2 };
+
+inline Cell opponent(const Cell& c) { return c == Cell::Blue ? Cell::Red : Cell::Blue; }
+//======================================================================================================
 /*Graph class is used for building the structure of the game by controlling the vertex and the edge.It can use various data structures like 
 arrays, queues,... to update the vertex.  */
 class Graph {
 public:
-    Graph(const size_t size = 7) : num_vertex(size) {
-        adjacent_matrix.resize(num_vertex);
-        weight_matrix.resize(num_vertex);
-        neighbors.resize(num_vertex);
-        vertices.resize(num_vertex);
+    /*Neighbors of one vertex as a contiguous slice of the adjacency array.*/
+    struct NeighborRange {
+        const size_t* first;
+        const size_t* last;
+        inline const size_t* begin() const { return first; }
+        inline const size_t* end() const { return last; }
+        inline size_t size() const { return static_cast<size_t>(last - first); }
+    };
 
-        for (size_t i = 0; i < num_vertex; ++i) {
-            adjacent_matrix[i].assign(num_vertex, false);
-            weight_matrix[i].assign(num_vertex, 0.0);
-            // Void string
-            vertices[i] = blank;
-        }//time complexity=O(n)
+    Graph(const size_t size = 7) : num_vertex(size) {
+        vertices.assign(num_vertex, blank);
+        // Compressed sparse row storage: the neighbors of x are
+        // adjacency[offsets[x]..offsets[x+1]) with the same slice in weights.
+        offsets.assign(num_vertex + 1, 0);
+        compressed = true;
     } // Constructor overload with file name
 
     ~Graph() {}
@@ -69,66 +138,67 @@ public:
 
     inline size_t V() const { return num_vertex; }
     inline size_t E() {
+        compress();
         n_edges = 0;
-        for (size_t x = 0; x < neighbors.size(); ++x) {
-            n_edges += neighbors[x].size();
+        for (size_t x = 0; x < num_vertex; ++x) {
+            for (auto y : neighbors(x)) {
+                // x-y edge =y-x edge, self loop stored once
+                n_edges += (y == x) ? 2 : 1;
+            }
         }//time complexity=O(n)
-        // x-y edge =y-x edge
         n_edges /= 2;
         return n_edges;
     }
     inline bool adjacent(const size_t& x, const size_t& y) {
-        return adjacent_matrix[x][y];
+        return find_edge(x, y) != npos;
+    }
+
+    inline NeighborRange neighbors(const size_t& x) {
+        compress();
+        return NeighborRange{ adjacency.data() + offsets[x], adjacency.data() + offsets[x + 1] };
     }
 
-    inline std::string get_node_value(const size_t& x) { return vertices[x]; }
+    inline Cell get_node_value(const size_t& x) { return vertices[x]; }
 
-    inline void set_node_value(const size_t& x, const std::string& a) {
+    inline void set_node_value(const size_t& x, const Cell& a) {
         vertices[x] = a;
     }
 
     inline void set_edge_value(const size_t& x, const size_t& y, const float& v) {
-        if (adjacent_matrix[x][y]) { // First need to be created
-            weight_matrix[x][y] = weight_matrix[y][x] = v;
+        size_t xy = find_edge(x, y);
+        if (xy != npos) { // First need to be created
+            weights[xy] = weights[find_edge(y, x)] = v;
         }
     }
 
-    inline void add_edge(const size_t& x, const size_t& y) {
-        if (!adjacent_matrix[x][y]) { // Add only if no edge already created
-            adjacent_matrix[x][y] = true;
-            neighbors[x].push_back(y);
-            if (y != x) {
-                adjacent_matrix[y][x] = true;
-                neighbors[y].push_back(x);
-            }
-            set_edge_value(x, y, 0.0); // Set weight to 0.0
-        }
+    /*Edges are staged and moved into the compressed rows on the next read, so building
+    the whole graph costs one counting sort of the edge list instead of one insertion per edge.*/
+    inline void add_edge(const size_t& x, const size_t& y, const float& v = 0.0) {
+        staged_edges.push_back(std::make_pair(std::make_pair(std::min(x, y), std::max(x, y)), v));
+        compressed = false;
     }
 
     inline void print_neighbors(const size_t& x) {
         std::cout << "List of neighboors of " << x << "\n";
-        for (auto n : neighbors[x]) {
+        for (auto n : neighbors(x)) {
             std::cout << " " << n << ",";
         }
         std::cout << "\n";
     }//time complexity=O(n)
 
     inline void delete_edge(const size_t& x, const size_t& y) {
-        if (adjacent_matrix[x][y]) { // Check it exists
-            adjacent_matrix[x][y] = adjacent_matrix[y][x] = false;
-            // The removed element is pushed to the end
-            std::remove(neighbors[x].begin(), neighbors[x].end(), y);
-            neighbors[x].pop_back();
+        size_t xy = find_edge(x, y);
+        if (xy != npos) { // Check it exists
+            erase_entry(x, xy);
             if (y != x) {
-                std::remove(neighbors[y].begin(), neighbors[y].end(), x);
-                // Resize for the removed element at the end
-                neighbors[y].pop_back();
+                erase_entry(y, find_edge(y, x));
             }
         }
     }
 
     inline float get_edge_value(const size_t& x, const size_t& y) {
-        return weight_matrix[x][y];
+        size_t xy = find_edge(x, y);
+        return xy != npos ? weights[xy] : 0.0f;
     }
 
     inline void PrintWeight() {
@@ -136,275 +206,2680 @@ public:
         for (size_t i = 0; i < num_vertex; i++) {
             for (size_t j = 0; j < num_vertex; j++) {
 
-                std::cout << ", " << weight_matrix[i][j];
+                std::cout << ", " << get_edge_value(i, j);
             }
         }//time complexity=O(n^2)
         std::cout << "\n";
     }
 
+    /*Merge staged edges into the compressed rows with a counting sort on the vertex:
+    degree histogram, prefix sum, then scatter of the current rows followed by the staged
+    edges in insertion order. An edge already in its row is skipped, so the first weight
+    given to an edge is kept and later add_edge are no-ops.*/
+    void compress() {
+        if (compressed) {
+            return;
+        }
+        std::vector<size_t> start(num_vertex + 1, 0);
+        for (size_t x = 0; x < num_vertex; ++x) {
+            start[x + 1] = offsets[x + 1] - offsets[x];
+        }//time complexity=O(n)
+        for (auto& e : staged_edges) {
+            start[e.first.first + 1]++;
+            if (e.first.second != e.first.first) {
+                start[e.first.second + 1]++;
+            }
+        }//time complexity=O(n)
+        for (size_t x = 0; x < num_vertex; ++x) {
+            start[x + 1] += start[x];
+        }//time complexity=O(n)
+        std::vector<size_t> rows(start[num_vertex]);
+        std::vector<float> row_weights(start[num_vertex]);
+        std::vector<size_t> fill(start.begin(), start.end() - 1);
+        for (size_t x = 0; x < num_vertex; ++x) {
+            for (size_t e = offsets[x]; e < offsets[x + 1]; ++e) {
+                rows[fill[x]] = adjacency[e];
+                row_weights[fill[x]++] = weights[e];
+            }
+        }//time complexity=O(n)
+        for (auto& e : staged_edges) {
+            size_t x = e.first.first, y = e.first.second;
+            if (std::find(rows.begin() + static_cast<std::ptrdiff_t>(start[x]),
+                rows.begin() + static_cast<std::ptrdiff_t>(fill[x]), y) != rows.begin() + static_cast<std::ptrdiff_t>(fill[x])) {
+                continue;
+            }
+            rows[fill[x]] = y;
+            row_weights[fill[x]++] = e.second;
+            if (y != x) {
+                rows[fill[y]] = x;
+                row_weights[fill[y]++] = e.second;
+            }
+        }//time complexity=O(n), rows hold a handful of entries
+        staged_edges.clear();
+
+        // Skipped duplicates leave holes at the end of their rows
+        adjacency.clear();
+        weights.clear();
+        for (size_t x = 0; x < num_vertex; ++x) {
+            offsets[x] = adjacency.size();
+            adjacency.insert(adjacency.end(), rows.begin() + static_cast<std::ptrdiff_t>(start[x]),
+                rows.begin() + static_cast<std::ptrdiff_t>(fill[x]));
+            weights.insert(weights.end(), row_weights.begin() + static_cast<std::ptrdiff_t>(start[x]),
+                row_weights.begin() + static_cast<std::ptrdiff_t>(fill[x]));
+        }//time complexity=O(n)
+        offsets[num_vertex] = adjacency.size();
+        compressed = true;
+    }
+
 protected:
     // vertices map internal node indexes to node values
-    std::vector<std::string> vertices;
-    std::vector<std::vector<bool>> adjacent_matrix;
-    std::vector<std::vector<float>> weight_matrix;
-    std::vector<std::vector<size_t>> neighbors;
+    std::vector<Cell> vertices;
+    std::vector<size_t> offsets;
+    std::vector<size_t> adjacency;
+    std::vector<float> weights;
+    std::vector<std::pair<std::pair<size_t, size_t>, float>> staged_edges;
+    bool compressed;
     size_t n_edges;
     size_t num_vertex;
     float m_density;
     float min_edge_length;
     float max_edge_length;
-    const std::string blank = " . ";
+    const Cell blank = Cell::Blank;
+    static const size_t npos = static_cast<size_t>(-1);
+
+    // Position of y in the row of x, rows hold a handful of entries
+    inline size_t find_edge(const size_t& x, const size_t& y) {
+        compress();
+        for (size_t e = offsets[x]; e < offsets[x + 1]; ++e) {
+            if (adjacency[e] == y) {
+                return e;
+            }
+        }
+        return npos;
+    }
+
+    inline void erase_entry(const size_t& x, const size_t& e) {
+        adjacency.erase(adjacency.begin() + static_cast<std::ptrdiff_t>(e));
+        weights.erase(weights.begin() + static_cast<std::ptrdiff_t>(e));
+        for (size_t i = x + 1; i <= num_vertex; ++i) {
+            offsets[i]--;
+        }
+    }
 };
 //======================================================================================================
-// Hex child class of Graph
-// See https://en.wikipedia.org/wiki/Hex_(board_game)
-// Pair (distance from source , node idx)
-/*Hex class uses graph class to build the game depending on the inputs from the user or the machine.*/
-typedef std::pair<float, size_t> ds_nidx;
-class Hex : public Graph {
+/*BoardTables class holds the tables of one table size N computed at compile time: the bit
+masks of the four borders in the BitBoard layout and the six clamped neighbors of every cell
+in the SlicedBoard layout. Its kernels see the word count and the shifts as constants, so
+the compiler unrolls their loops and drops the bound checks. BitBoard and SlicedBoard use
+them for the common sizes below and keep their runtime code for the others.*/
+template <size_t N>
+struct BoardTables {
+    static constexpr size_t stride = N + 1;
+    static constexpr size_t num_vertex = N * N;
+    static constexpr size_t num_words = (N * stride + 63) / 64;
+    typedef std::array<uint64_t, num_words> Board;
+    typedef std::array<std::array<uint16_t, 6>, num_vertex> Neighbors;
+
+    // First or last row (up, down) or column (left, right)
+    static constexpr Board border(const bool rows, const bool last) {
+        Board mask{};
+        size_t line = last ? N - 1 : 0;
+        for (size_t i = 0; i < N; ++i) {
+            size_t b = rows ? line * stride + i : i * stride + line;
+            mask[b >> 6] |= uint64_t(1) << (b & 63);
+        }
+        return mask;
+    }
+
+    // Left, right, up, down, right up, down left, clamped on the cell at the borders
+    static constexpr Neighbors neighbors() {
+        Neighbors n{};
+        for (size_t row = 0; row < N; ++row) {
+            for (size_t col = 0; col < N; ++col) {
+                size_t up = row ? row - 1 : row, down = row + 1 < N ? row + 1 : row;
+                size_t left = col ? col - 1 : col, right = col + 1 < N ? col + 1 : col;
+                auto& c = n[row * N + col];
+                c[0] = static_cast<uint16_t>(row * N + left);
+                c[1] = static_cast<uint16_t>(row * N + right);
+                c[2] = static_cast<uint16_t>(up * N + col);
+                c[3] = static_cast<uint16_t>(down * N + col);
+                c[4] = static_cast<uint16_t>(up * N + right);
+                c[5] = static_cast<uint16_t>(down * N + left);
+            }
+        }
+        return n;
+    }
+
+    static constexpr Board top = border(true, false);
+    static constexpr Board bottom = border(true, true);
+    static constexpr Board left = border(false, false);
+    static constexpr Board right = border(false, true);
+    static constexpr Neighbors nbr = neighbors();
+
+    /*Same flood fill as BitBoard::connects, stones has num_words words.*/
+    static bool connects(const uint64_t* stones, const bool& up_down) {
+        const Board& src = up_down ? top : left;
+        const Board& dst = up_down ? bottom : right;
+        Board reach, next;
+        bool any = false;
+        for (size_t i = 0; i < num_words; ++i) {
+            reach[i] = stones[i] & src[i];
+            any = any || reach[i];
+        }
+        while (any) {
+            bool changed = false;
+            for (size_t i = 0; i < num_words; ++i) {
+                uint64_t w = reach[i] | shl<1>(reach, i) | shr<1>(reach, i) |
+                    shl<stride>(reach, i) | shr<stride>(reach, i) |
+                    shl<stride - 1>(reach, i) | shr<stride - 1>(reach, i);
+                next[i] = w & stones[i];
+                if (next[i] & dst[i]) {
+                    return true;
+                }
+                changed = changed || next[i] != reach[i];
+            }
+            if (!changed) {
+                return false;
+            }
+            reach = next;
+        }//time complexity=O(n) per sweep
+        return false;
+    }
+
+    /*Same sweeps as SlicedBoard::red_wins, red has num_vertex lanes.*/
+    static uint64_t red_wins(const uint64_t* red) {
+        std::array<uint64_t, num_vertex> reach{};
+        for (size_t v = 0; v < N; ++v) {
+            reach[v] = red[v];
+        }
+        uint64_t changed = 1;
+        while (changed) {
+            changed = 0;
+            for (size_t v = 0; v < num_vertex; ++v) {
+                changed |= grow(red, reach, v);
+            }
+            for (size_t v = num_vertex; v-- > 0;) {
+                changed |= grow(red, reach, v);
+            }
+        }//time complexity=O(n) per sweep
+        uint64_t wins = 0;
+        for (size_t v = num_vertex - N; v < num_vertex; ++v) {
+            wins |= reach[v];
+        }
+        return wins;
+    }
+
+private:
+    // Word i of (board << K) and (board >> K)
+    template <size_t K>
+    static inline uint64_t shl(const Board& board, const size_t& i) {
+        constexpr size_t q = K >> 6, r = K & 63;
+        if (i < q) return 0;
+        uint64_t w = board[i - q] << r;
+        if constexpr (r != 0) {
+            if (i > q) w |= board[i - q - 1] >> (64 - r);
+        }
+        return w;
+    }
+
+    template <size_t K>
+    static inline uint64_t shr(const Board& board, const size_t& i) {
+        constexpr size_t q = K >> 6, r = K & 63;
+        if (i + q >= num_words) return 0;
+        uint64_t w = board[i + q] >> r;
+        if constexpr (r != 0) {
+            if (i + q + 1 < num_words) w |= board[i + q + 1] << (64 - r);
+        }
+        return w;
+    }
+
+    static inline uint64_t grow(const uint64_t* red, std::array<uint64_t, num_vertex>& reach, const size_t& v) {
+        const auto& n = nbr[v];
+        uint64_t r = reach[v] | (red[v] & (reach[n[0]] | reach[n[1]] | reach[n[2]] |
+            reach[n[3]] | reach[n[4]] | reach[n[5]]));
+        uint64_t changed = r ^ reach[v];
+        reach[v] = r;
+        return changed;
+    }
+};
+
+// Kernels of one specialized size, null pointers for the other sizes
+struct FixedKernels {
+    bool (*connects)(const uint64_t*, const bool&) = nullptr;
+    uint64_t(*red_wins)(const uint64_t*) = nullptr;
+};
+
+template <size_t N>
+inline FixedKernels fixed_kernels_of() {
+    FixedKernels k;
+    k.connects = &BoardTables<N>::connects;
+    k.red_wins = &BoardTables<N>::red_wins;
+    return k;
+}
+
+/*Runtime dispatch from the table size to its instantiation.*/
+inline FixedKernels fixed_kernels(const size_t& size) {
+    switch (size) {
+    case 7: return fixed_kernels_of<7>();
+    case 9: return fixed_kernels_of<9>();
+    case 11: return fixed_kernels_of<11>();
+    case 13: return fixed_kernels_of<13>();
+    case 19: return fixed_kernels_of<19>();
+    default: return FixedKernels();
+    }
+}
+//======================================================================================================
+/*CacheLineAllocator class gives vectors a buffer that starts on a cache line and fills whole
+lines, so the buffers written by different threads never share a line.*/
+template <typename T>
+class CacheLineAllocator {
 public:
-    Hex(const size_t size = 7, const bool HumanVsHuman = false)
-        : Graph(size* size), m_HvsH(HumanVsHuman) {
-        num_cols = size;
-        Left_indexes.resize(num_cols);
-        // gen_shift generator function incrementing by first argument
-        // Starting at second argument.
-        gen_shift Left(num_cols, 0);
-        std::generate(Left_indexes.begin(), Left_indexes.end(), Left);
-        Right_indexes.resize(num_cols);
-        gen_shift Right(num_cols, num_cols - 1);
-        std::generate(Right_indexes.begin(), Right_indexes.end(), Right);
+    typedef T value_type;
+    static const size_t line = 64;
 
-        Up_indexes.resize(num_cols);
-        gen_shift Up(1, 0);
-        std::generate(Up_indexes.begin(), Up_indexes.end(), Up);
-        Down_indexes.resize(num_cols);
-        gen_shift Down(1, num_cols * (num_cols - 1));
-        std::generate(Down_indexes.begin(), Down_indexes.end(), Down);
+    CacheLineAllocator() = default;
+    template <typename U>
+    CacheLineAllocator(const CacheLineAllocator<U>&) {}
 
-        game_table.resize(num_cols);
+    T* allocate(const size_t n) {
+        size_t bytes = (n * sizeof(T) + line - 1) / line * line;
+        return static_cast<T*>(::operator new(bytes, std::align_val_t(line)));
+    }
+    void deallocate(T* p, const size_t) { ::operator delete(p, std::align_val_t(line)); }
+
+    template <typename U>
+    bool operator==(const CacheLineAllocator<U>&) const { return true; }
+    template <typename U>
+    bool operator!=(const CacheLineAllocator<U>&) const { return false; }
+};
+
+// Per thread counters of the playouts
+typedef std::vector<long int, CacheLineAllocator<long int>> Counters;
+//======================================================================================================
+/*BitBoard class stores a filled hex table with one bit per cell and decides connections with a
+bit-parallel flood fill. Rows are stored with one guard bit after the last column, so every shift
+that would wrap around a row lands on a guard bit which is never set. */
+class BitBoard {
+public:
+    typedef std::vector<uint64_t, CacheLineAllocator<uint64_t>> Words;
+
+    BitBoard(const size_t size = 7) : num_cols(size), stride(size + 1), fixed(fixed_kernels(size).connects) {
+        num_words = (num_cols * stride + 63) / 64;
+        bit_index.resize(num_cols * num_cols);
+        for (size_t v = 0; v < bit_index.size(); ++v) {
+            bit_index[v] = (v / num_cols) * stride + v % num_cols;
+        }//time complexity=O(n)
+        top_mask.assign(num_words, 0);
+        bottom_mask.assign(num_words, 0);
         for (size_t i = 0; i < num_cols; ++i) {
-            game_table[i].assign(num_cols, blank);
+            set(top_mask, i);
+            set(bottom_mask, (num_cols - 1) * num_cols + i);
         }//time complexity=O(n)
-        game_it = 0;
-        previous_it = 0;
-
-        Opposites[blue] = std::vector<bool>();
+    }
 
-        Opposites[red] = std::vector<bool>();
+    inline void clear(Words& board) const { board.assign(num_words, 0); }
 
-        // Opposite side check existing
-        Opposites[blue].assign(num_vertex, false);
+    // Vertex number (row major) to bit position
+    inline size_t bit(const size_t& v) const { return bit_index[v]; }
 
-        Opposites[red].assign(num_vertex, false);
+    inline void set(Words& board, const size_t& v) const {
+        size_t b = bit(v);
+        board[b >> 6] |= uint64_t(1) << (b & 63);
+    }
 
-        for (auto it = Right_indexes.begin(); it != Right_indexes.end(); ++it) {
-            Opposites[blue][*it] = true;
-        }//time complexity=O(n)
+    inline bool test(const Words& board, const size_t& v) const {
+        size_t b = bit(v);
+        return (board[b >> 6] >> (b & 63)) & 1;
+    }
 
-        for (auto it = Down_indexes.begin(); it != Down_indexes.end(); ++it) {
-            Opposites[red][*it] = true;
-        }//time complexity=O(n)
+    /*Flood fill of stones from the up border, true when it reaches the down border.
+    reach and next are scratch boards so that no allocation happens per playout.
+    A filled table has exactly one winner, so red stones are enough to decide it.*/
+    inline bool connects_up_down(const Words& stones, Words& reach, Words& next) const {
+        return fixed ? fixed(stones.data(), true) : connects(stones, top_mask, bottom_mask, reach, next);
+    }
 
-        local_neighbors.reserve(6);
+private:
+    size_t num_cols;
+    size_t stride;
+    // Specialized flood fill of the common sizes
+    bool (*fixed)(const uint64_t*, const bool&);
+    size_t num_words;
+    std::vector<size_t> bit_index;
+    Words top_mask;
+    Words bottom_mask;
 
-        hex_graph();
+    // Word i of (board << k) and (board >> k) for a multi word board
+    inline uint64_t shl(const Words& board, const size_t& i, const size_t& k) const {
+        size_t q = k >> 6, r = k & 63;
+        if (i < q) return 0;
+        uint64_t w = board[i - q] << r;
+        if (r && i > q) w |= board[i - q - 1] >> (64 - r);
+        return w;
     }
 
-    ~Hex() {}
+    inline uint64_t shr(const Words& board, const size_t& i, const size_t& k) const {
+        size_t q = k >> 6, r = k & 63;
+        if (i + q >= num_words) return 0;
+        uint64_t w = board[i + q] >> r;
+        if (r && i + q + 1 < num_words) w |= board[i + q + 1] << (64 - r);
+        return w;
+    }
 
-    // Forbid copy constructor since we do not want to use it here
-    Hex(const Hex&) = delete;
-    //---------------------------------------------------------------
- /*It shows how the game is displayed in terminal window.*/   
- void display_game() {
-        for (size_t i = 0; i < num_cols; ++i) {
-            std::cout << std::string(2 * i, ' ');
-            for (size_t j = 0; j < num_cols; ++j) {
-                std::cout << game_table[i][j];
-                if (j < num_cols - 1) {
-                    std::cout << "-";
+    bool connects(const Words& stones, const Words& src, const Words& dst,
+        Words& reach, Words& next) const {
+        if (num_cols > max_shift_fill) {
+            return connects_by_cells(stones, src, dst, reach, next);
+        }
+        reach.resize(num_words);
+        next.resize(num_words);
+        bool any = false;
+        for (size_t i = 0; i < num_words; ++i) {
+            reach[i] = stones[i] & src[i];
+            any = any || reach[i];
+        }
+        // Grow along the six hex directions until fixpoint:
+        // Left/Right (1), Up/Down (stride), RightUp/DownLeft (stride-1)
+        while (any) {
+            bool changed = false;
+            for (size_t i = 0; i < num_words; ++i) {
+                uint64_t w = reach[i] | shl(reach, i, 1) | shr(reach, i, 1) |
+                    shl(reach, i, stride) | shr(reach, i, stride) |
+                    shl(reach, i, stride - 1) | shr(reach, i, stride - 1);
+                next[i] = w & stones[i];
+                if (next[i] & dst[i]) {
+                    return true;
                 }
+                changed = changed || next[i] != reach[i];
             }
-            std::cout << " " << i;
-            if (i < num_cols - 1) {
-                std::cout << "\n";
-                std::cout << std::string(2 * i + 1, ' ');
-                std::generate_n(std::ostream_iterator<std::string>(std::cout, ""),
-                    num_cols - 1, []() { return " \\ /"; });
-                std::cout << " \\\n";
-            }
-            else { // Last line
-                std::cout << "\n";
-                std::cout << std::string(2 * (num_cols - 2) + 1, ' ');
-                for (size_t j = 0; j < num_cols; ++j) {
-                    std::cout << "  " << j << " ";
-                }
-                std::cout << "\n";
+            if (!changed) {
+                return false;
             }
-        }//time complexity=O(n^2)
-    }/*Overall time complexity=O(n^2)*/
-    //-------------------------------------------------------------------------
-  /*Deciding the result of the game dpending on the various cases.*/  
- bool game_over(std::string request_player, size_t num_trial) {
+            reach.swap(next);
+        }//time complexity=O(n) per sweep
+        return false;
+    }
 
-        if (game_it == 0 && !m_HvsH) {
-            if (request_player == "x" || request_player == "X") {
-                first_player = 1;
-            }
-            else {
-                first_player = 0;
-            }
-        }
+    // A sweep of the shift fill moves the front by one cell, and the paths of random fills
+    // wind a lot on big tables: there the cell by cell fill below is faster
+    static const size_t max_shift_fill = 32;
 
-        if (play(num_trial)) {
-            const std::string* current_player;
-            std::vector<size_t>* BorderMin;
-            // Iteration just played
-            if (previous_it % 2) {
-                current_player = &red;
-                BorderMin = &Up_indexes;
-                // BorderMax = &Down_indexes;
-            }
-            else {
-                current_player = &blue;
-                BorderMin = &Left_indexes;
-                // BorderMax = &Right_indexes;
+    /*Depth first fill of the stones from src, each stone visited once. reach holds the
+    visited bits and next is used as the stack of bit positions. The guard bits are never
+    stones, so the six offsets need no row checks.*/
+    bool connects_by_cells(const Words& stones, const Words& src, const Words& dst,
+        Words& reach, Words& next) const {
+        reach.assign(num_words, 0);
+        next.resize(num_cols * num_cols);
+        size_t top = 0;
+        for (size_t i = 0; i < num_words; ++i) {
+            for (uint64_t w = stones[i] & src[i]; w; w &= w - 1) {
+                size_t b = (i << 6) + static_cast<size_t>(__builtin_ctzll(w));
+                reach[i] |= w & (~w + 1);
+                next[top++] = b;
             }
-
-            if (UnionFind(*BorderMin, *current_player, vertices)) {
-                std::cout << "Game over, player " << *current_player << " wins!\n";
+        }
+        const size_t end = num_cols * stride;
+        const size_t offsets[3] = { 1, stride, stride - 1 };
+        while (top > 0) {
+            size_t b = next[--top];
+            if ((dst[b >> 6] >> (b & 63)) & 1) {
                 return true;
             }
-
-            if (game_it >= num_vertex) {
-                std::cout << "Game over, draw game\n";
-                return true;
+            for (size_t off : offsets) {
+                for (size_t nb : { b + off, b - off }) {
+                    // b - off wraps to a huge value above the first row
+                    if (nb < end && ((stones[nb >> 6] & ~reach[nb >> 6]) >> (nb & 63)) & 1) {
+                        reach[nb >> 6] |= uint64_t(1) << (nb & 63);
+                        next[top++] = nb;
+                    }
+                }
             }
+        }//time complexity=O(n)
+        return false;
+    }
+};
+//======================================================================================================
+/*DisjointSet class is a union-find forest with union by rank and path compression,
+so a sequence of unions and finds costs almost O(1) per operation.*/
+class DisjointSet {
+public:
+    DisjointSet(const size_t size = 0) { reset(size); }
 
-            return false;
+    inline void reset(const size_t& size) {
+        parent.resize(size);
+        rank.assign(size, 0);
+        std::iota(parent.begin(), parent.end(), 0);
+    }//time complexity=O(n)
 
+    inline size_t find(size_t x) {
+        // Path halving: every visited node points to its grand parent
+        while (parent[x] != x) {
+            parent[x] = parent[parent[x]];
+            x = parent[x];
         }
-        else { // If play
-            return false;
-        }
+        return x;
     }
 
-    //-----------------------------------------------------
-    bool play(size_t num_trial) {
-        const std::string* current_player;
-        const std::string* current_path;
-        std::string player_input;
-        if (game_it == 0) {
-            
-            auto start = high_resolution_clock::now();  //measuring execution time of graph process
-             
-            display_game();
-
-            auto stop = high_resolution_clock::now();
-            auto duration = duration_cast<microseconds>(stop - start);
-            std::cout << "execution time of graph process is: "<<duration.count() << " microseconds\n" ;
+    inline void unite(const size_t& x, const size_t& y) {
+        size_t rx = find(x), ry = find(y);
+        if (rx == ry) {
+            return;
         }
-        if (game_it % 2) {
-            current_player = &red;
-            current_path = &UpDown;
+        if (rank[rx] < rank[ry]) {
+            std::swap(rx, ry);
         }
-        else {
-            current_player = &blue;
-            current_path = &LeftRight;
+        parent[ry] = rx;
+        if (rank[rx] == rank[ry]) {
+            rank[rx]++;
         }
-        size_t col, row;
-
-        std::cout << "Iteration number " << game_it << "\n";
-        std::cout << "Player " << *current_player << ", path " << *current_path;
-        std::cout << " please enter (row,column)"
-            << "\n";
-        // First player may not be machine if = 1
-        if (m_HvsH || (game_it + first_player) % 2) {
-            std::cin >> player_input;
-            if (!(std::stringstream(player_input) >> row)) {
-                std::cout << "Wrong input type, please enter \n";
-                std::cout << "only numbers (row enter, column enter).\n";
-                return false;
-            }
-            std::cin >> player_input;
-            if (!(std::stringstream(player_input) >> col)) {
-                std::cout << "Wrong input type, please enter number\n";
-                return false;
-            }
+    }
 
-            if (row >= num_cols || col >= num_cols) {
+    inline bool same(const size_t& x, const size_t& y) { return find(x) == find(y); }
 
-                std::cout << "Illegal position," << *current_player
-                    << "please play again"
-                    << "\n";
-                return false;
-            }
-            if (game_it == 0) {
-                // Middle
-                inv_map[0] = (num_cols) / 2;
-                inv_map[1] = (num_cols) / 2;
+private:
+    std::vector<size_t> parent;
+    std::vector<unsigned char> rank;
+};
+//======================================================================================================
+/*Xoshiro256 class is the xoshiro256** generator: 256 bits of state, a few shifts and
+rotations per draw, and jump() to move 2^128 draws ahead so that parallel workers get
+non overlapping streams. It satisfies UniformRandomBitGenerator.*/
+class Xoshiro256 {
+public:
+    typedef uint64_t result_type;
 
-                if (row == inv_map[0] && col == inv_map[1]) {
-                    first_player++;
-                    std::cout << "The machine has taken your position!\n";
-                }
-            }
+    Xoshiro256(const uint64_t seed_value = 0) { seed(seed_value); }
 
+    // The state is expanded from the seed with splitmix64 as advised by the authors
+    inline void seed(uint64_t seed_value) {
+        for (auto& word : state) {
+            seed_value += 0x9E3779B97F4A7C15ULL;
+            uint64_t z = seed_value;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            word = z ^ (z >> 31);
         }
-        else {
-            std::cout << "Simulation running, please wait...\n";
-            
-            auto start = high_resolution_clock::now(); //measuring execution time of montecarlo alogorithm
-            
-            size_t vertex_num = MonteCarlo(*current_player, num_trial);
-            
-            auto stop = high_resolution_clock::now();
-            auto duration = duration_cast<microseconds>(stop - start);
-            std::cout << "execution time of montecarlo is: "<<duration.count() << " microseconds\n" ;
-            
-            
-            inv_map = InvMapV(vertex_num);
+    }
 
-            row = inv_map[0];
-            col = inv_map[1];
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
 
-            if (game_it == 0) {
+    inline result_type operator()() {
+        const uint64_t result = rotl(state[1] * 5, 7) * 9;
+        const uint64_t t = state[1] << 17;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = rotl(state[3], 45);
+        return result;
+    }
 
-                std::cout << "The machine has played "
-                    << "(" << row << "," << col << ")"
-                    << ".\n";
-                std::cout << "Would you like to take his position ? y(yes), n(no) \n";
+    /*Integer in [0, range) by multiply-shift of the high 32 bits, no division.
+    The bias is below range / 2^32, negligible for table sizes.*/
+    inline uint32_t bounded(const uint32_t range) {
+        return static_cast<uint32_t>(((*this)() >> 32) * range >> 32);
+    }
 
-                std::string Input = "";
-                std::cin >> Input;
-                if (Input == "y" || Input == "Y") {
-                    first_player++;
-                    std::cout << "The human has taken your position\n";
+    // Equivalent to 2^128 calls of operator()
+    inline void jump() {
+        static const uint64_t JUMP[] = { 0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+            0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL };
+        std::array<uint64_t, 4> jumped = { {0, 0, 0, 0} };
+        for (auto word : JUMP) {
+            for (int b = 0; b < 64; ++b) {
+                if (word & (uint64_t(1) << b)) {
+                    for (size_t i = 0; i < 4; ++i) {
+                        jumped[i] ^= state[i];
+                    }
                 }
+                (*this)();
             }
         }
+        state = jumped;
+    }
 
-        if (game_table[row][col] == blank) {
-            game_table[row][col] = *current_player;
-            auto u = MapV(row, col);
-            assert(u < num_vertex);
-            vertices[u] = *current_player;
-            std::cout << "Player " << *current_player << " has played "
-                << "(" << row << "," << col << ")"
-                << "\n";
-            display_game();
-            previous_it = game_it;
-            game_it++;
-            return true;
-        }
+    // Independent stream for a worker, this generator jumps past it
+    inline Xoshiro256 split() {
+        Xoshiro256 stream = *this;
+        jump();
+        return stream;
+    }
+
+private:
+    std::array<uint64_t, 4> state;
+
+    static inline uint64_t rotl(const uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+};
+
+// Generator used by the playouts, any class with bounded(), jump() and split() fits
+typedef Xoshiro256 Rng;
+
+// Fisher-Yates shuffle drawing with Rng::bounded instead of uniform_int_distribution
+template <typename RandomIt>
+inline void shuffle_range(RandomIt first, RandomIt last, Rng& rng) {
+    for (auto n = static_cast<uint32_t>(last - first); n > 1; --n) {
+        std::iter_swap(first + (n - 1), first + rng.bounded(n));
+    }
+}
+//======================================================================================================
+/*SlicedBoard class plays 64 random fills at once in a transposed (bit sliced) layout: the
+word of a cell holds that cell in 64 independent games, bit l being set when red owns the
+cell in game l. Fills and the up-down flood fill are word-wide boolean operations, and the
+result is a mask of the games won by red. Words are 64 bits, the loops are plain enough
+for the compiler to vectorize them.*/
+class SlicedBoard {
+public:
+    typedef std::vector<uint64_t, CacheLineAllocator<uint64_t>> Lanes;
+
+    SlicedBoard(const size_t size = 7) : num_cols(size), num_vertex(size* size), fixed(fixed_kernels(size).red_wins) {
+        // Six clamped neighbors per cell, a cell clamped on itself changes nothing
+        nbr.resize(6 * num_vertex);
+        for (size_t row = 0; row < num_cols; ++row) {
+            for (size_t col = 0; col < num_cols; ++col) {
+                size_t up = row ? row - 1 : row, down = std::min(row + 1, num_cols - 1);
+                size_t left = col ? col - 1 : col, right = std::min(col + 1, num_cols - 1);
+                uint32_t* n = &nbr[6 * (row * num_cols + col)];
+                n[0] = static_cast<uint32_t>(row * num_cols + left);
+                n[1] = static_cast<uint32_t>(row * num_cols + right);
+                n[2] = static_cast<uint32_t>(up * num_cols + col);
+                n[3] = static_cast<uint32_t>(down * num_cols + col);
+                n[4] = static_cast<uint32_t>(up * num_cols + right);
+                n[5] = static_cast<uint32_t>(down * num_cols + left);
+            }
+        }//time complexity=O(n)
+    }
+
+    /*64 draws that are 1 with probability threshold/256, from one random word per
+    significant bit of threshold: res = bit ? (r | res) : (r & res), from the lowest bit,
+    is the bit sliced comparison U < threshold of a uniform 8 bits U.*/
+    static inline uint64_t bernoulli(Rng& rng, const unsigned& threshold) {
+        if (threshold >= 256) {
+            return ~uint64_t(0);
+        }
+        if (threshold == 0) {
+            return 0;
+        }
+        unsigned b = 0;
+        while (!((threshold >> b) & 1)) {
+            ++b; // Trailing zero bits keep res at 0
+        }
+        uint64_t res = 0;
+        for (; b < 8; ++b) {
+            uint64_t r = rng();
+            res = ((threshold >> b) & 1) ? (r | res) : (r & res);
+        }
+        return res;
+    }
+
+    /*Mask of the games where red connects up and down. red holds the lanes of every cell
+    and reach is scratch. Forward and backward sweeps alternate until nothing changes.*/
+    uint64_t red_wins(const Lanes& red, Lanes& reach) const {
+        if (fixed) {
+            return fixed(red.data());
+        }
+        reach.assign(num_vertex, 0);
+        for (size_t v = 0; v < num_cols; ++v) {
+            reach[v] = red[v];
+        }
+        uint64_t changed = 1;
+        while (changed) {
+            changed = 0;
+            for (size_t v = 0; v < num_vertex; ++v) {
+                changed |= grow(red, reach, v);
+            }
+            for (size_t v = num_vertex; v-- > 0;) {
+                changed |= grow(red, reach, v);
+            }
+        }//time complexity=O(n) per sweep
+        uint64_t wins = 0;
+        for (size_t v = num_vertex - num_cols; v < num_vertex; ++v) {
+            wins |= reach[v];
+        }
+        return wins;
+    }
+
+private:
+    size_t num_cols;
+    size_t num_vertex;
+    // Specialized sweeps of the common sizes
+    uint64_t(*fixed)(const uint64_t*);
+    std::vector<uint32_t> nbr;
+
+    inline uint64_t grow(const Lanes& red, Lanes& reach, const size_t& v) const {
+        const uint32_t* n = &nbr[6 * v];
+        uint64_t r = reach[v] | (red[v] & (reach[n[0]] | reach[n[1]] | reach[n[2]] |
+            reach[n[3]] | reach[n[4]] | reach[n[5]]));
+        uint64_t changed = r ^ reach[v];
+        reach[v] = r;
+        return changed;
+    }
+};
+//======================================================================================================
+/*Zobrist class holds one random key per (color, cell) and one for the player to move.
+The hash of a table is the XOR of the keys of its stones, so placing a stone is one XOR.*/
+class Zobrist {
+public:
+    Zobrist(const size_t size = 49) {
+        // Fixed seed: hashes are the same from one run to the next
+        Xoshiro256 g(0x48455821ULL);
+        keys.resize(2 * size);
+        for (auto& k : keys) {
+            k = g();
+        }
+        side_key = g();
+    }
+
+    inline uint64_t key(const Cell& c, const size_t& v) const {
+        return keys[2 * v + (c == Cell::Red)];
+    }
+    // XORed in when red is to move
+    inline uint64_t side() const { return side_key; }
+
+private:
+    std::vector<uint64_t> keys;
+    uint64_t side_key;
+};
+//======================================================================================================
+/*TranspositionTable class stores visit and win statistics of positions by Zobrist hash.
+Its size is fixed in MB and it is split in buckets of one cache line holding four entries.
+A position goes to bucket hash & mask, and replaces the entry of its bucket with the fewest
+visits when it is not already there.*/
+class TranspositionTable {
+public:
+    struct Entry {
+        uint64_t key;
+        uint32_t visits;
+        float wins;
+    };
+    struct alignas(64) Bucket {
+        std::array<Entry, 4> entries;
+    };
+
+    TranspositionTable() { resize(0); }
+
+    // Largest power of two number of buckets fitting in mb megabytes, 0 disables the table
+    void resize(const size_t& mb) {
+        size_t count = 0;
+        if (mb > 0) {
+            count = 1;
+            while (count * 2 * sizeof(Bucket) <= mb * 1024 * 1024) {
+                count *= 2;
+            }
+        }
+        buckets.assign(count, Bucket());
+        mask = count ? count - 1 : 0;
+        reset_counters();
+    }
+
+    inline bool enabled() const { return !buckets.empty(); }
+
+    // Forgets every entry, the size stays
+    inline void clear() {
+        std::fill(buckets.begin(), buckets.end(), Bucket());
+        reset_counters();
+    }
+
+    inline const Entry* probe(const uint64_t& key) {
+        if (!enabled()) {
+            return nullptr;
+        }
+        for (auto& e : buckets[key & mask].entries) {
+            if (e.key == key && e.visits) {
+                hits++;
+                return &e;
+            }
+        }
+        misses++;
+        return nullptr;
+    }
+
+    inline void store(const uint64_t& key, const uint32_t& visits, const float& wins) {
+        if (!enabled()) {
+            return;
+        }
+        Bucket& b = buckets[key & mask];
+        Entry* victim = &b.entries[0];
+        for (auto& e : b.entries) {
+            if (e.key == key) {
+                victim = &e;
+                break;
+            }
+            if (e.visits < victim->visits) {
+                victim = &e;
+            }
+        }
+        if (victim->key != key && victim->visits) {
+            collisions++;
+        }
+        victim->key = key;
+        victim->visits = visits;
+        victim->wins = wins;
+    }
+
+    inline void reset_counters() { hits = misses = collisions = 0; }
+    size_t hits, misses, collisions;
+
+private:
+    std::vector<Bucket> buckets;
+    size_t mask;
+};
+//======================================================================================================
+/*OpeningBook class reads the book of one table size: the best move and its value for the
+positions of the first plies, by canonical hash. The file is a header (magic "HEXBOOK1",
+table size, number of slots, a power of two) and the slots {key, move, value}, an open
+addressing table probed linearly from key & (slots - 1), key 0 marking empty slots. The
+reader maps the file in memory and probes it in place; write() is used by the builder.*/
+class OpeningBook {
+public:
+    struct Header {
+        char magic[8];
+        uint32_t size;
+        uint32_t num_slots;
+    };
+    struct Entry {
+        uint64_t key;
+        uint32_t move;
+        float value;
+    };
+
+    OpeningBook() = default;
+    OpeningBook(const OpeningBook&) = delete;
+    ~OpeningBook() { close(); }
+
+    /*Maps the book at path, false when it is missing or made for another table size.*/
+    bool open(const std::string& path, const size_t& size) {
+        close();
+#ifdef HEX_HAVE_MMAP
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(Header)) {
+            mapped_bytes = static_cast<size_t>(st.st_size);
+            void* m = mmap(nullptr, mapped_bytes, PROT_READ, MAP_SHARED, fd, 0);
+            mapping = m == MAP_FAILED ? nullptr : m;
+        }
+        ::close(fd);
+        const char* bytes = static_cast<const char*>(mapping);
+#else
+        std::ifstream file(path, std::ios::binary);
+        copy.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        mapped_bytes = copy.size();
+        const char* bytes = copy.empty() ? nullptr : copy.data();
+#endif
+        if (bytes == nullptr || mapped_bytes < sizeof(Header)) {
+            close();
+            return false;
+        }
+        Header header;
+        std::memcpy(&header, bytes, sizeof(Header));
+        size_t slots = header.num_slots;
+        if (std::memcmp(header.magic, "HEXBOOK1", 8) != 0 || header.size != size || slots == 0 ||
+            (slots & (slots - 1)) != 0 || mapped_bytes < sizeof(Header) + slots * sizeof(Entry)) {
+            close();
+            return false;
+        }
+        num_slots = slots;
+        entries = reinterpret_cast<const Entry*>(bytes + sizeof(Header));
+        return true;
+    }
+
+    void close() {
+#ifdef HEX_HAVE_MMAP
+        if (mapping != nullptr) {
+            munmap(mapping, mapped_bytes);
+        }
+#else
+        copy.clear();
+#endif
+        mapping = nullptr;
+        mapped_bytes = 0;
+        entries = nullptr;
+        num_slots = 0;
+    }
+
+    inline bool loaded() const { return entries != nullptr; }
+
+    bool probe(const uint64_t& key, uint32_t& move, float& value) const {
+        if (!loaded()) {
+            return false;
+        }
+        uint64_t k = stored(key);
+        for (size_t i = k & (num_slots - 1), n = 0; n < num_slots; i = (i + 1) & (num_slots - 1), ++n) {
+            if (entries[i].key == k) {
+                move = entries[i].move;
+                value = entries[i].value;
+                return true;
+            }
+            if (entries[i].key == 0) {
+                return false;
+            }
+        }
+        return false;
+    }
+
+    /*Writes entries at path, the table is kept at most half full.*/
+    static bool write(const std::string& path, const size_t& size, const std::vector<Entry>& book) {
+        size_t slots = 16;
+        while (slots < 2 * book.size()) {
+            slots *= 2;
+        }
+        std::vector<Entry> table(slots, Entry{ 0, 0, 0.0f });
+        for (const Entry& e : book) {
+            uint64_t k = stored(e.key);
+            size_t i = k & (slots - 1);
+            while (table[i].key != 0 && table[i].key != k) {
+                i = (i + 1) & (slots - 1);
+            }
+            table[i] = Entry{ k, e.move, e.value };
+        }//time complexity=O(n)
+        Header header;
+        std::memcpy(header.magic, "HEXBOOK1", 8);
+        header.size = static_cast<uint32_t>(size);
+        header.num_slots = static_cast<uint32_t>(slots);
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+        file.write(reinterpret_cast<const char*>(table.data()), static_cast<std::streamsize>(slots * sizeof(Entry)));
+        return static_cast<bool>(file);
+    }
+
+private:
+    const Entry* entries = nullptr;
+    size_t num_slots = 0;
+    void* mapping = nullptr;
+    size_t mapped_bytes = 0;
+#ifndef HEX_HAVE_MMAP
+    std::vector<char> copy;
+#endif
+
+    // Key 0 marks the empty slots
+    static inline uint64_t stored(const uint64_t& key) { return key ? key : 1; }
+};
+//======================================================================================================
+// Outcome of the solver for the player to move
+enum class Proof : unsigned char { Unknown, Win, Loss };
+
+/*Solver class proves the winner of a table by depth-first proof-number search (df-pn) with
+the 1 + 1/4 threshold rule. Each node has a proof number phi (cost of proving a win of the
+player to move) and a disproof number delta, phi is the least delta of the children and
+delta the sum of their phi. Nodes are searched while both stay under their thresholds and
+their numbers go to a bounded table of buckets of four entries, keyed by Zobrist hash,
+replacing the entry of its bucket with the least work. Before expanding a node the winning
+cells of both players are found from the groups touching an edge: a winning cell of the
+mover proves the node, two winning cells of the other player disprove it and one must be
+blocked, so it is the only child. Chains of bridges and edge templates decide a node as
+soon as one player is virtually connected, and the children are the must-play cells: the
+cells that break every connection the other player could make in one move.*/
+class Solver {
+public:
+    struct Result {
+        Proof proof = Proof::Unknown;
+        size_t move = 0;
+        size_t nodes = 0;
+        double ms = 0.0;
+    };
+
+    Solver(const size_t size = 7)
+        : num_cols(size), num_vertex(size* size), zobrist(size* size), table_mb(16) {
+        const int n = static_cast<int>(num_cols);
+        const int dr[6] = { -1, -1, 0, 1, 1, 0 };
+        const int dc[6] = { 0, 1, 1, 0, -1, -1 };
+        adjacent.resize(num_vertex);
+        edges.resize(num_vertex);
+        for (size_t v = 0; v < num_vertex; ++v) {
+            int row = static_cast<int>(v / num_cols), col = static_cast<int>(v % num_cols);
+            for (size_t k = 0; k < 6; ++k) {
+                int r = row + dr[k], c = col + dc[k];
+                adjacent[v][k] = r < 0 || r >= n || c < 0 || c >= n ? -1 : r * n + c;
+            }
+            // Bits 0 and 1 for blue left and right, bits 2 and 3 for red up and down
+            edges[v] = static_cast<unsigned char>((col == 0) | (col == n - 1) << 1 | (row == 0) << 2 | (row == n - 1) << 3);
+        }//time complexity=O(n)
+        // Central cells first
+        order.resize(num_vertex);
+        std::iota(order.begin(), order.end(), size_t(0));
+        auto distance = [&](const size_t& v) {
+            int r = 2 * static_cast<int>(v / num_cols) - (n - 1), c = 2 * static_cast<int>(v % num_cols) - (n - 1);
+            return std::max({ std::abs(r), std::abs(c), std::abs(r + c) });
+        };
+        std::stable_sort(order.begin(), order.end(),
+            [&](const size_t& a, const size_t& b) { return distance(a) < distance(b); });
+        label.resize(num_vertex);
+    }
+
+    // Table size in MB, allocated by the first solve
+    inline void set_table_mb(const size_t& mb) { table_mb = std::max<size_t>(mb, 1); }
+    // Forgets the numbers of earlier solves, a later solve then only depends on its position
+    inline void clear() { std::fill(table.begin(), table.end(), Entry{ 0, 0, 0, 0 }); }
+
+    /*Solves board with player to move, gives up after max_nodes expansions or max_ms
+    milliseconds (0 for no limit). The move of a win is a winning move.*/
+    Result solve(const std::vector<Cell>& board, const Cell& player, const size_t& max_nodes, const double& max_ms) {
+        if (table.size() != table_entries(table_mb)) {
+            table.assign(table_entries(table_mb), Entry{ 0, 0, 0, 0 });
+        }
+        auto t0 = steady_clock::now();
+        Result result;
+        cells = board;
+        nodes = 0;
+        node_limit = std::max<size_t>(max_nodes, 1);
+        deadline = max_ms > 0 ? t0 + duration_cast<steady_clock::duration>(duration<double, std::milli>(max_ms))
+            : steady_clock::time_point::max();
+        aborted = false;
+        Cell other = player == Cell::Blue ? Cell::Red : Cell::Blue;
+        if (won(player) || won(other)) {
+            result.proof = won(player) ? Proof::Win : Proof::Loss;
+            return result;
+        }
+        uint64_t hash = player == Cell::Red ? zobrist.side() : 0;
+        for (size_t v = 0; v < num_vertex; ++v) {
+            hash ^= cells[v] != Cell::Blank ? zobrist.key(cells[v], v) : 0;
+        }//time complexity=O(n)
+        uint32_t phi = 1, delta = 1;
+        size_t best = num_vertex;
+        mid(hash, player, infinity, infinity, phi, delta, best);
+        if (phi == 0 || delta == 0) {
+            result.proof = phi == 0 ? Proof::Win : Proof::Loss;
+        }
+        result.move = best;
+        result.nodes = nodes;
+        result.ms = duration<double, std::milli>(steady_clock::now() - t0).count();
+        return result;
+    }
+
+private:
+    struct Entry {
+        uint64_t key;
+        uint32_t phi;
+        uint32_t delta;
+        uint32_t work;
+    };
+    struct Child {
+        size_t move;
+        uint32_t phi;
+        uint32_t delta;
+    };
+    static constexpr uint32_t infinity = 1u << 30;
+
+    size_t num_cols;
+    size_t num_vertex;
+    Zobrist zobrist;
+    size_t table_mb;
+    std::vector<Entry> table;
+    std::vector<std::array<int32_t, 6>> adjacent;
+    std::vector<unsigned char> edges;
+    std::vector<size_t> order;
+    std::vector<Cell> cells;
+    // Scratch of winning_cells: group of each stone and edges of each group
+    std::vector<uint32_t> label;
+    std::vector<unsigned char> group_edges;
+    // Scratch of virtual_win: (end, end, cell) triples, links by end and the search
+    std::vector<std::array<uint32_t, 3>> triples;
+    std::vector<std::array<uint32_t, 4>> links;
+    std::vector<uint32_t> link_start;
+    std::vector<uint32_t> link_list;
+    std::vector<uint32_t> parent;
+    std::vector<uint32_t> queue;
+    // Scratch of must_play
+    std::vector<unsigned char> allowed;
+    std::vector<size_t> semi_carrier;
+    size_t nodes = 0;
+    size_t node_limit = 0;
+    steady_clock::time_point deadline;
+    bool aborted = false;
+
+    // Power of two number of entries in mb megabytes
+    static size_t table_entries(const size_t& mb) {
+        size_t count = 4;
+        while (count * 2 * sizeof(Entry) <= mb * 1024 * 1024) {
+            count *= 2;
+        }
+        return count;
+    }
+
+    inline bool lookup(const uint64_t& key, uint32_t& phi, uint32_t& delta) const {
+        size_t first = key & (table.size() - 4);
+        for (size_t i = first; i < first + 4; ++i) {
+            if (table[i].key == key) {
+                phi = table[i].phi;
+                delta = table[i].delta;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    inline void store(const uint64_t& key, const uint32_t& phi, const uint32_t& delta, const size_t& work) {
+        size_t first = key & (table.size() - 4);
+        Entry* victim = &table[first];
+        for (size_t i = first; i < first + 4; ++i) {
+            if (table[i].key == key) {
+                victim = &table[i];
+                break;
+            }
+            if (table[i].work < victim->work) {
+                victim = &table[i];
+            }
+        }
+        *victim = Entry{ key, phi, delta, static_cast<uint32_t>(std::min<size_t>(work, UINT32_MAX)) };
+    }
+
+    // Edge bits of player in a mask of edges
+    static inline unsigned char side_bits(const Cell& player) { return player == Cell::Blue ? 3 : 12; }
+
+    /*Groups of the stones of player with the edges they touch.*/
+    void group_stones(const Cell& player) {
+        const uint32_t none = UINT32_MAX;
+        std::fill(label.begin(), label.end(), none);
+        group_edges.clear();
+        std::vector<size_t> stack;
+        for (size_t v = 0; v < num_vertex; ++v) {
+            if (cells[v] != player || label[v] != none) {
+                continue;
+            }
+            uint32_t id = static_cast<uint32_t>(group_edges.size());
+            unsigned char mask = 0;
+            label[v] = id;
+            stack.push_back(v);
+            while (!stack.empty()) {
+                size_t u = stack.back();
+                stack.pop_back();
+                mask |= edges[u];
+                for (int32_t w : adjacent[u]) {
+                    if (w >= 0 && cells[static_cast<size_t>(w)] == player && label[static_cast<size_t>(w)] == none) {
+                        label[static_cast<size_t>(w)] = id;
+                        stack.push_back(static_cast<size_t>(w));
+                    }
+                }
+            }
+            group_edges.push_back(static_cast<unsigned char>(mask & side_bits(player)));
+        }//time complexity=O(n)
+    }
+
+    bool won(const Cell& player) {
+        group_stones(player);
+        return std::find(group_edges.begin(), group_edges.end(), side_bits(player)) != group_edges.end();
+    }
+
+    /*Blank cells where a stone of player joins its two edges.*/
+    void winning_cells(const Cell& player, std::vector<size_t>& wins) {
+        group_stones(player);
+        wins.clear();
+        for (size_t v = 0; v < num_vertex; ++v) {
+            if (cells[v] != Cell::Blank) {
+                continue;
+            }
+            unsigned char mask = static_cast<unsigned char>(edges[v] & side_bits(player));
+            for (int32_t w : adjacent[v]) {
+                if (w >= 0 && cells[static_cast<size_t>(w)] == player) {
+                    mask |= group_edges[label[static_cast<size_t>(w)]];
+                }
+            }
+            if (mask == side_bits(player)) {
+                wins.push_back(v);
+            }
+        }//time complexity=O(n)
+    }
+
+    /*Virtual connection of the edges of player whoever moves next. Groups and edges are
+    joined by links of two blank cells each touching both ends, bridges and the template
+    of a stone on the second row, and a chain of links with pairwise disjoint cells holds:
+    the other player breaking into a link is answered on its second cell. The chain is
+    searched breadth first keeping the first link that reaches an end, so a connection can
+    be missed but none is wrong. carrier gets the cells of the chain.*/
+    bool virtual_win(const Cell& player, std::vector<size_t>& carrier) {
+        group_stones(player);
+        const uint32_t first_edge = static_cast<uint32_t>(group_edges.size()), second_edge = first_edge + 1;
+        const uint32_t none = UINT32_MAX, cell_none = static_cast<uint32_t>(num_vertex);
+        const unsigned char sides = side_bits(player);
+        // Blank cells touching two ends
+        triples.clear();
+        for (size_t v = 0; v < num_vertex; ++v) {
+            if (cells[v] != Cell::Blank) {
+                continue;
+            }
+            std::array<uint32_t, 8> ends;
+            size_t count = 0;
+            if (edges[v] & sides & 5) {
+                ends[count++] = first_edge;
+            }
+            if (edges[v] & sides & 10) {
+                ends[count++] = second_edge;
+            }
+            for (int32_t w : adjacent[v]) {
+                if (w >= 0 && cells[static_cast<size_t>(w)] == player) {
+                    uint32_t id = label[static_cast<size_t>(w)];
+                    if (std::find(ends.begin(), ends.begin() + static_cast<std::ptrdiff_t>(count), id)
+                        == ends.begin() + static_cast<std::ptrdiff_t>(count)) {
+                        ends[count++] = id;
+                    }
+                }
+            }
+            for (size_t i = 0; i < count; ++i) {
+                for (size_t j = i + 1; j < count; ++j) {
+                    triples.push_back({ {std::min(ends[i], ends[j]), std::max(ends[i], ends[j]), static_cast<uint32_t>(v)} });
+                }
+            }
+        }//time complexity=O(n)
+        std::sort(triples.begin(), triples.end());
+        // Links {end, end, cell, cell}, stones on an edge are joined to it without cells
+        links.clear();
+        for (uint32_t g = 0; g < first_edge; ++g) {
+            if (group_edges[g] & 5) {
+                links.push_back({ {g, first_edge, cell_none, cell_none} });
+            }
+            if (group_edges[g] & 10) {
+                links.push_back({ {g, second_edge, cell_none, cell_none} });
+            }
+        }//time complexity=O(n)
+        for (size_t i = 0; i + 1 < triples.size(); ++i) {
+            if (triples[i][0] == triples[i + 1][0] && triples[i][1] == triples[i + 1][1]) {
+                links.push_back({ {triples[i][0], triples[i][1], triples[i][2], triples[i + 1][2]} });
+                while (i + 1 < triples.size() && triples[i][0] == triples[i + 1][0] && triples[i][1] == triples[i + 1][1]) {
+                    ++i;
+                }
+            }
+        }//time complexity=O(n)
+        // Links of each end
+        link_start.assign(second_edge + 2, 0);
+        for (auto& l : links) {
+            link_start[l[0] + 1]++;
+            link_start[l[1] + 1]++;
+        }
+        for (size_t e = 1; e < link_start.size(); ++e) {
+            link_start[e] += link_start[e - 1];
+        }
+        link_list.resize(2 * links.size());
+        for (uint32_t k = 0; k < links.size(); ++k) {
+            link_list[link_start[links[k][0]]++] = k;
+            link_list[link_start[links[k][1]]++] = k;
+        }
+        for (size_t e = link_start.size() - 1; e > 0; --e) {
+            link_start[e] = link_start[e - 1];
+        }
+        link_start[0] = 0;
+        // Breadth first from the first edge, parent is the link that reached an end
+        parent.assign(second_edge + 1, none);
+        queue.assign(1, first_edge);
+        parent[first_edge] = cell_none;
+        for (size_t head = 0; head < queue.size(); ++head) {
+            uint32_t u = queue[head];
+            for (uint32_t i = link_start[u]; i < link_start[u + 1]; ++i) {
+                const auto& l = links[link_list[i]];
+                uint32_t w = l[0] == u ? l[1] : l[0];
+                if (parent[w] != none) {
+                    continue;
+                }
+                // The cells of the chain up to u stay disjoint
+                bool disjoint = true;
+                for (uint32_t back = u; back != first_edge && disjoint; ) {
+                    const auto& p = links[parent[back]];
+                    disjoint = l[2] == cell_none || (l[2] != p[2] && l[2] != p[3] && l[3] != p[2] && l[3] != p[3]);
+                    back = p[0] == back ? p[1] : p[0];
+                }
+                if (!disjoint) {
+                    continue;
+                }
+                parent[w] = link_list[i];
+                if (w == second_edge) {
+                    carrier.clear();
+                    for (uint32_t back = w; back != first_edge; ) {
+                        const auto& p = links[parent[back]];
+                        if (p[2] != cell_none) {
+                            carrier.push_back(p[2]);
+                            carrier.push_back(p[3]);
+                        }
+                        back = p[0] == back ? p[1] : p[0];
+                    }
+                    return true;
+                }
+                queue.push_back(w);
+            }
+        }//time complexity=O(n)
+        return false;
+    }
+
+    /*Blank cells, central first, where the player to move may play: when a stone of other
+    on a cell would give it a virtual connection, a move elsewhere than this cell and the
+    carrier of the connection loses, so moves is the intersection of these sets. Empty
+    when every move loses.*/
+    void must_play(const Cell& other, std::vector<size_t>& moves) {
+        allowed.assign(num_vertex, 1);
+        for (size_t v = 0; v < num_vertex; ++v) {
+            if (cells[v] != Cell::Blank) {
+                continue;
+            }
+            cells[v] = other;
+            bool semi = virtual_win(other, semi_carrier);
+            cells[v] = Cell::Blank;
+            if (semi) {
+                for (auto c : semi_carrier) {
+                    allowed[c] |= 2;
+                }
+                allowed[v] |= 2;
+                // Only the cells of every set so far keep their low bit
+                for (auto& a : allowed) {
+                    a = (a & 2) ? (a & 1) : 0;
+                }
+            }
+        }//time complexity=O(n^2)
+        moves.clear();
+        for (size_t v : order) {
+            if (cells[v] == Cell::Blank && allowed[v]) {
+                moves.push_back(v);
+            }
+        }//time complexity=O(n)
+    }
+
+    /*Multiple iterative deepening of one node: its children are searched until phi reaches
+    thphi or delta reaches thdelta, best is the winning child once phi is 0.*/
+    void mid(const uint64_t& hash, const Cell& player, const uint32_t& thphi, const uint32_t& thdelta,
+        uint32_t& phi, uint32_t& delta, size_t& best) {
+        size_t start = nodes++;
+        if (nodes >= node_limit || ((nodes & 1023) == 0 && steady_clock::now() > deadline)) {
+            aborted = true;
+        }
+        Cell other = player == Cell::Blue ? Cell::Red : Cell::Blue;
+        std::vector<size_t> threats;
+        winning_cells(player, threats);
+        if (!threats.empty()) {
+            phi = 0;
+            delta = infinity;
+            best = threats[0];
+            store(hash, phi, delta, 1);
+            return;
+        }
+        std::vector<size_t> carrier;
+        if (virtual_win(player, carrier)) {
+            // Any move keeps the connection, a cell of the chain makes a link solid
+            phi = 0;
+            delta = infinity;
+            best = carrier.empty() ? best : carrier[0];
+            store(hash, phi, delta, 1);
+            return;
+        }
+        winning_cells(other, threats);
+        if (threats.size() >= 2 || virtual_win(other, carrier)) {
+            phi = infinity;
+            delta = 0;
+            store(hash, phi, delta, 1);
+            return;
+        }
+        if (threats.empty()) {
+            must_play(other, threats);
+            if (threats.empty()) {
+                phi = infinity;
+                delta = 0;
+                store(hash, phi, delta, 1);
+                return;
+            }
+        }
+        std::vector<Child> children;
+        for (size_t v : threats) {
+            if (cells[v] == Cell::Blank) {
+                Child c{ v, 1, 1 };
+                lookup(hash ^ zobrist.key(player, v) ^ zobrist.side(), c.phi, c.delta);
+                children.push_back(c);
+            }
+        }//time complexity=O(n)
+        while (true) {
+            // Best child has the least delta, delta2 is the second least
+            size_t first = 0;
+            uint32_t delta2 = infinity;
+            uint64_t sum = 0;
+            phi = infinity;
+            for (size_t i = 0; i < children.size(); ++i) {
+                if (children[i].delta < phi) {
+                    delta2 = phi;
+                    phi = children[i].delta;
+                    first = i;
+                }
+                else if (children[i].delta < delta2) {
+                    delta2 = children[i].delta;
+                }
+                sum += children[i].phi;
+            }//time complexity=O(n)
+            delta = static_cast<uint32_t>(std::min<uint64_t>(sum, infinity));
+            if (phi == 0) {
+                best = children[first].move;
+            }
+            if (phi >= thphi || delta >= thdelta || aborted) {
+                break;
+            }
+            Child& c = children[first];
+            uint32_t child_thphi = static_cast<uint32_t>(std::min<uint64_t>(uint64_t(thdelta) - delta + c.phi, infinity));
+            uint32_t child_thdelta = static_cast<uint32_t>(std::min<uint64_t>(thphi,
+                uint64_t(delta2) + delta2 / 4 + 1));
+            size_t reply = num_vertex;
+            cells[c.move] = player;
+            mid(hash ^ zobrist.key(player, c.move) ^ zobrist.side(), other, child_thphi, child_thdelta,
+                c.phi, c.delta, reply);
+            cells[c.move] = Cell::Blank;
+        }
+        store(hash, phi, delta, nodes - start);
+    }
+};
+//======================================================================================================
+/*TimeManager class turns a per move deadline or a game clock (base plus increment) into a
+thinking time for each move. With a game clock the share of the remaining time grows when
+few cells are left and in the middle game, and the search may stop at half of the target
+when its best move has not changed for most of the time already spent, or go on up to the
+hard limit while the best move keeps changing. Searches poll should_stop() often enough
+to stop within a few milliseconds of the limit.*/
+class TimeManager {
+public:
+    // Fixed thinking time per move
+    inline void set_move_time(const double& ms) {
+        mode = ms > 0 ? PerMove : None;
+        move_ms = ms;
+    }
+
+    inline void set_game_clock(const double& base_ms, const double& inc_ms) {
+        mode = base_ms > 0 ? GameClock : None;
+        remaining = base_ms;
+        increment = inc_ms;
+    }
+
+    // Remaining time of the game clock, e.g. given by an external controller
+    inline void set_remaining(const double& ms) { remaining = ms; }
+
+    inline bool enabled() const { return mode != None; }
+    inline bool game_clock() const { return mode == GameClock; }
+    inline double remaining_ms() const { return remaining; }
+    inline double target_ms() const { return target; }
+
+    /*Start the clock of a move with empty_cells blank cells, game_it stones played.*/
+    void start(const size_t& game_it, const size_t& empty_cells) {
+        start_time = steady_clock::now();
+        last_best = std::numeric_limits<size_t>::max();
+        last_change = 0.0;
+        if (mode == PerMove) {
+            target = limit = std::max(move_ms - margin, 1.0);
+            return;
+        }
+        // Our moves still to play if the game went on a while longer
+        double moves_left = std::max(4.0, static_cast<double>(empty_cells) / 3.0);
+        double share = remaining / moves_left;
+        size_t total = game_it + empty_cells;
+        // The middle game decides most games
+        if (game_it * 5 >= total && game_it * 5 <= 3 * total) {
+            share *= 1.3;
+        }
+        double available = std::max(remaining - margin, 1.0);
+        target = std::min(share + 0.8 * increment, available);
+        limit = std::min(3.0 * target, std::max(available * 0.4, target));
+    }
+
+    inline double elapsed_ms() const {
+        return duration<double, std::milli>(steady_clock::now() - start_time).count();
+    }
+
+    /*Polled by the searches with their current best move.*/
+    bool should_stop(const size_t& best_move) {
+        double elapsed = elapsed_ms();
+        if (best_move != last_best) {
+            last_best = best_move;
+            last_change = elapsed;
+        }
+        if (elapsed >= limit) {
+            return true;
+        }
+        if (mode == PerMove) {
+            return false;
+        }
+        double stable = elapsed - last_change;
+        if (elapsed >= 0.5 * target && stable >= 0.75 * elapsed) {
+            return true;
+        }
+        return elapsed >= target && stable >= 0.25 * elapsed;
+    }
+
+    // Stop the clock of the move, returns the time spent
+    double finish() {
+        double elapsed = elapsed_ms();
+        if (mode == GameClock) {
+            remaining += increment - elapsed;
+        }
+        return elapsed;
+    }
+
+private:
+    enum Mode { None, PerMove, GameClock };
+    Mode mode = None;
+    double move_ms = 0.0;
+    double remaining = 0.0;
+    double increment = 0.0;
+    // Kept for the answer to reach the caller
+    const double margin = 3.0;
+    double target = 0.0;
+    // Hard stop of the move, read by should_stop
+    double limit = 0.0;
+    steady_clock::time_point start_time;
+    size_t last_best = 0;
+    double last_change = 0.0;
+};
+//======================================================================================================
+// Measures of one machine move, filled by every search
+struct SearchStats {
+    size_t move = 0;
+    double time_ms = 0.0;
+    size_t playouts = 0;
+    size_t threads = 1;
+    // Busy time of the threads over their wall time
+    double utilization = 1.0;
+    // Nodes of the search tree after the move, 0 for flat Monte Carlo
+    size_t tree_nodes = 0;
+    // Move read from the opening book, no search
+    bool book = false;
+    // Solver outcome for the mover and its expansions, Unknown when it did not run
+    Proof proof = Proof::Unknown;
+    size_t solver_nodes = 0;
+};
+
+/*Telemetry class writes JSON lines: one object per machine move (time, playouts, playouts/s,
+move and value, the best alternatives, the thread utilization and the tree size) and one
+per game and engine with the p50/p95/p99 move latencies. It is off until open() is called, and the
+searches only fill a SearchStats, so the games without telemetry do no extra work. Match games running
+on several threads may share one Telemetry.*/
+class Telemetry {
+public:
+    // "stderr" or a file, lines are appended to the file
+    bool open(const std::string& target) {
+        if (target == "stderr") {
+            out = &std::cerr;
+        }
+        else {
+            file.open(target, std::ios::app);
+            out = file.is_open() ? &file : nullptr;
+        }
+        return out != nullptr;
+    }
+
+    inline bool enabled() const { return out != nullptr; }
+    // Number of alternatives given with each move
+    inline void set_top(const size_t& k) { top_k = k; }
+    inline size_t top() const { return top_k; }
+
+    void move(const size_t& game, const std::string& engine, const size_t& number, const std::string& player,
+        const std::string& move_name, const double& value, const SearchStats& stats,
+        const std::vector<std::pair<std::string, double>>& alternatives) {
+        double pps = stats.time_ms > 0 ? 1000.0 * static_cast<double>(stats.playouts) / stats.time_ms : 0.0;
+        std::ostringstream line;
+        line << "{\"event\":\"move\",\"game\":" << game << ",\"engine\":\"" << engine
+            << "\",\"number\":" << number << ",\"player\":\"" << player << "\",\"move\":\"" << move_name
+            << "\",\"value\":" << value << ",\"time_ms\":" << stats.time_ms << ",\"playouts\":" << stats.playouts
+            << ",\"pps\":" << pps << ",\"threads\":" << stats.threads << ",\"utilization\":" << stats.utilization
+            << ",\"tree_nodes\":" << stats.tree_nodes
+            << ",\"book\":" << (stats.book ? "true" : "false") << ",\"proof\":\""
+            << (stats.proof == Proof::Win ? "win" : stats.proof == Proof::Loss ? "loss" : "none")
+            << "\",\"solver_nodes\":" << stats.solver_nodes << ",\"top\":[";
+        for (size_t k = 0; k < alternatives.size(); ++k) {
+            line << (k ? "," : "") << "{\"move\":\"" << alternatives[k].first << "\",\"value\":"
+                << alternatives[k].second << "}";
+        }
+        line << "]}\n";
+        std::lock_guard<std::mutex> guard(lock);
+        GameRecord& record = games[std::make_pair(game, engine)];
+        record.latencies.push_back(stats.time_ms);
+        record.playouts += stats.playouts;
+        *out << line.str() << std::flush;
+    }
+
+    /*One line per engine that played in the game, so the engines of a match game get
+    their own percentiles.*/
+    void game_over(const size_t& game, const std::string& winner) {
+        std::lock_guard<std::mutex> guard(lock);
+        auto first = games.lower_bound(std::make_pair(game, std::string()));
+        auto it = first;
+        for (; it != games.end() && it->first.first == game; ++it) {
+            std::vector<double>& latencies = it->second.latencies;
+            std::sort(latencies.begin(), latencies.end());
+            *out << "{\"event\":\"game\",\"game\":" << game << ",\"engine\":\"" << it->first.second
+                << "\",\"winner\":\"" << winner << "\",\"machine_moves\":" << latencies.size()
+                << ",\"playouts\":" << it->second.playouts
+                << ",\"p50_ms\":" << percentile(latencies, 0.50) << ",\"p95_ms\":" << percentile(latencies, 0.95)
+                << ",\"p99_ms\":" << percentile(latencies, 0.99)
+                << ",\"max_ms\":" << (latencies.empty() ? 0.0 : latencies.back()) << "}\n";
+        }//time complexity=O(n log n)
+        *out << std::flush;
+        games.erase(first, it);
+    }
+
+private:
+    struct GameRecord {
+        std::vector<double> latencies;
+        size_t playouts = 0;
+    };
+    std::ostream* out = nullptr;
+    std::ofstream file;
+    size_t top_k = 5;
+    std::mutex lock;
+    // Records by game and engine label
+    std::map<std::pair<size_t, std::string>, GameRecord> games;
+
+    // Nearest rank percentile of sorted values
+    static double percentile(const std::vector<double>& sorted, const double& q) {
+        if (sorted.empty()) {
+            return 0.0;
+        }
+        size_t rank = static_cast<size_t>(std::ceil(q * static_cast<double>(sorted.size())));
+        return sorted[std::max<size_t>(rank, 1) - 1];
+    }
+};
+//======================================================================================================
+/*NodeArena class hands out tree nodes from one contiguous vector. The children of a node
+are allocated together and linked by index, so the tree stays compact and is released
+in O(1) since nodes are trivially destructible.*/
+template <typename Node>
+class NodeArena {
+public:
+    // Index of the first of count new zeroed nodes
+    inline uint32_t allocate(const size_t& count) {
+        uint32_t first = static_cast<uint32_t>(nodes.size());
+        nodes.resize(nodes.size() + count);
+        return first;
+    }
+    inline void clear() { nodes.clear(); }
+    inline size_t size() const { return nodes.size(); }
+    inline Node& operator[](const uint32_t& i) { return nodes[i]; }
+    inline const Node& operator[](const uint32_t& i) const { return nodes[i]; }
+
+private:
+    std::vector<Node> nodes;
+};
+//======================================================================================================
+// Search algorithm used by the machine
+enum class Engine : unsigned char { Flat, Mcts, Rave };
+
+// Playout kernel of the flat Monte Carlo: one shuffle per game, 64 games bit sliced, or
+// sequential games answering the intrusions into bridges
+enum class Kernel : unsigned char { Bitboard, Sliced, Bridges };
+
+// Spread of the flat Monte Carlo budget: uniform win_prob scoring or sequential halving
+enum class Allocation : unsigned char { Uniform, Halving };
+
+inline const char* engine_name(const Engine& e) {
+    return e == Engine::Mcts ? "mcts" : (e == Engine::Rave ? "rave" : "montecarlo");
+}
+
+inline Engine engine_from_name(const std::string& name) {
+    return name == "mcts" ? Engine::Mcts : (name == "rave" ? Engine::Rave : Engine::Flat);
+}
+
+inline const char* kernel_name(const Kernel& k) {
+    return k == Kernel::Sliced ? "sliced" : (k == Kernel::Bridges ? "bridges" : "bitboard");
+}
+
+inline Kernel kernel_from_name(const std::string& name) {
+    return name == "sliced" ? Kernel::Sliced : (name == "bridges" ? Kernel::Bridges : Kernel::Bitboard);
+}
+//======================================================================================================
+/*MCTS class is an UCT Monte Carlo tree search: selection with UCB1, expansion of all the
+blank cells of a leaf, random fill playout decided by the bitboard and backpropagation.
+Node wins are counted for the player who played the move of the node.
+With RAVE the tree is limited to a few plies and every node also keeps all-moves-as-first
+statistics: a child gets an AMAF sample whenever its cell ends up with the color of the
+player to move in a playout below its parent, like win_prob in MonteCarlo.*/
+class MCTS {
+public:
+    struct Node {
+        uint32_t first_child;
+        uint32_t num_children;
+        uint32_t move;
+        uint32_t visits;
+        float wins;
+        uint32_t amaf_visits;
+        float amaf_wins;
+    };
+
+    MCTS(const BitBoard& board, const Zobrist& keys, const size_t size)
+        : bitboard(board), zobrist(keys), num_vertex(size), exploration(0.7), max_nodes(4000000) {}
+
+    inline TranspositionTable& transpositions() { return tt; }
+
+    inline void set_exploration(const double& c) { exploration = c; }
+    inline void set_max_nodes(const size_t& n) { max_nodes = std::max<size_t>(n, 1024); }
+    // beta = sqrt(k / (3 visits + k)) weights AMAF against UCT, the tree stops at max_depth
+    inline void set_rave(const bool& enabled, const double& k, const size_t& max_depth) {
+        rave = enabled;
+        rave_k = k;
+        rave_depth = std::max<size_t>(max_depth, 1);
+    }
+    inline size_t tree_size() const { return arena.size(); }
+    // Playouts already below the root when the last search started
+    inline size_t reused_playouts() const { return reused; }
+
+    /*Best move for to_move after num_playouts iterations from the given cells. The tree
+    kept by advance() is searched further when it is rooted at this position.
+    hash is the Zobrist hash of the stones of cells. With a clock the search runs until
+    the clock stops it instead of num_playouts.*/
+    size_t search(const std::vector<Cell>& cells, const Cell to_move, size_t num_playouts, Rng& rng,
+        const uint64_t& hash, TimeManager* clock = nullptr) {
+        if (arena.size() == 0 || cells != tree_cells || to_move != tree_to_move) {
+            reset(cells, to_move);
+        }
+        tt.reset_counters();
+        reused = arena[root].visits;
+        root_blanks.clear();
+        bitboard.clear(base_red);
+        for (size_t v = 0; v < num_vertex; ++v) {
+            if (cells[v] == Cell::Blank) {
+                root_blanks.push_back(v);
+            }
+            else if (cells[v] == Cell::Red) {
+                bitboard.set(base_red, v);
+            }
+        }//time complexity=O(n)
+        if (root_blanks.empty()) {
+            return 0;
+        }
+
+        for (size_t it = 0; clock || it < num_playouts; ++it) {
+            if (clock && it % 16 == 0 && clock->should_stop(best_move())) {
+                break;
+            }
+            if (it % 16 == 0 && stop_requested.load(std::memory_order_relaxed)) {
+                break;
+            }
+            sim_cells = cells;
+            uint32_t node = root;
+            Cell player = to_move;
+            path.clear();
+            path.push_back(node);
+            hashes.clear();
+            hashes.push_back(hash ^ (to_move == Cell::Red ? zobrist.side() : 0));
+            // Selection
+            while (arena[node].num_children > 0) {
+                node = select_child(node);
+                descend(node, player);
+            }
+            // Expansion once the leaf has already been simulated
+            if (arena[node].visits > 0 && (!rave || path.size() <= rave_depth) &&
+                expand(node, player)) {
+                node = select_child(node);
+                descend(node, player);
+            }
+            Cell winner = playout(player, rng);
+            // Backpropagation, the move of a node at odd depth is played by to_move
+            arena[root].visits++;
+            for (size_t depth = 1; depth < path.size(); ++depth) {
+                Node& n = arena[path[depth]];
+                n.visits++;
+                if ((depth % 2 ? to_move : opponent(to_move)) == winner) {
+                    n.wins += 1.0f;
+                }
+                tt.store(hashes[depth], n.visits, n.wins);
+            }
+            if (rave) {
+                update_amaf(to_move, winner);
+            }
+        }//time complexity=O(n) per playout
+
+        playouts = arena[root].visits - reused;
+        return best_move();
+    }
+
+    // Playouts run by the last search
+    inline size_t last_playouts() const { return playouts; }
+
+    // Playouts below the root if the tree is rooted at this position
+    inline size_t root_playouts(const std::vector<Cell>& cells, const Cell& to_move) const {
+        if (arena.size() == 0 || to_move != tree_to_move || cells != tree_cells) {
+            return 0;
+        }
+        return arena[root].visits;
+    }
+
+    // A search running on another thread returns within 16 playouts once asked to stop
+    inline void request_stop() { stop_requested = true; }
+    inline void clear_stop() { stop_requested = false; }
+    // Position changed by other means than a move (undo, new game)
+    inline void clear() { arena.clear(); }
+    // Unrelated position: the transposition table goes too
+    inline void forget() {
+        arena.clear();
+        tt.clear();
+    }
+
+    // Win rate of the player to move for every visited move of the root
+    std::vector<std::pair<size_t, double>> root_values() const {
+        std::vector<std::pair<size_t, double>> values;
+        if (arena.size() == 0) {
+            return values;
+        }
+        const Node& r = arena[root];
+        for (uint32_t c = r.first_child; c < r.first_child + r.num_children; ++c) {
+            if (arena[c].visits > 0) {
+                values.emplace_back(arena[c].move, arena[c].wins / static_cast<double>(arena[c].visits));
+            }
+        }
+        return values;
+    }
+
+    // Most visited move is the most robust choice
+    size_t best_move() const {
+        const Node& r = arena[root];
+        if (r.num_children == 0) {
+            return root_blanks.empty() ? 0 : root_blanks[0];
+        }
+        uint32_t best = r.first_child;
+        for (uint32_t c = r.first_child; c < r.first_child + r.num_children; ++c) {
+            if (arena[c].visits > arena[best].visits) {
+                best = c;
+            }
+        }
+        return arena[best].move;
+    }
+
+    /*Move played on the table: the subtree of that move becomes the new root and the
+    rest of the tree is freed. Without such a subtree the tree is dropped.*/
+    void advance(const size_t& move, const Cell& player) {
+        if (arena.size() == 0) {
+            return;
+        }
+        if (player != tree_to_move) {
+            arena.clear();
+            return;
+        }
+        const Node& r = arena[root];
+        uint32_t child = r.first_child + r.num_children;
+        for (uint32_t c = r.first_child; c < r.first_child + r.num_children; ++c) {
+            if (arena[c].move == move) {
+                child = c;
+                break;
+            }
+        }
+        if (child == r.first_child + r.num_children) {
+            arena.clear();
+            return;
+        }
+        reroot(child);
+        tree_cells[move] = player;
+        tree_to_move = opponent(player);
+    }
+
+private:
+    const BitBoard& bitboard;
+    const Zobrist& zobrist;
+    size_t num_vertex;
+    double exploration;
+    size_t max_nodes;
+    NodeArena<Node> arena;
+    // Second arena used to compact the kept subtree
+    NodeArena<Node> spare;
+    uint32_t root = 0;
+    // Position of the root
+    std::vector<Cell> tree_cells;
+    Cell tree_to_move = Cell::Blank;
+    size_t reused = 0;
+    size_t playouts = 0;
+    std::atomic<bool> stop_requested{ false };
+    std::vector<std::pair<uint32_t, uint32_t>> copy_queue;
+    bool rave = false;
+    double rave_k = 1000.0;
+    size_t rave_depth = 3;
+    // Scratch of one iteration
+    std::vector<Cell> sim_cells;
+    std::vector<uint32_t> path;
+    // Zobrist hash (stones and player to move) of every node of the path
+    std::vector<uint64_t> hashes;
+    TranspositionTable tt;
+    std::vector<size_t> root_blanks;
+    std::vector<size_t> empties;
+    BitBoard::Words base_red;
+    BitBoard::Words red;
+    BitBoard::Words reach;
+    BitBoard::Words next;
+
+    void reset(const std::vector<Cell>& cells, const Cell& to_move) {
+        arena.clear();
+        root = arena.allocate(1);
+        tree_cells = cells;
+        tree_to_move = to_move;
+    }
+
+    // Copy the subtree of new_root breadth first into the spare arena and swap them,
+    // so siblings stay contiguous and the dropped part costs nothing to free
+    void reroot(const uint32_t& new_root) {
+        spare.clear();
+        uint32_t top = spare.allocate(1);
+        spare[top] = arena[new_root];
+        copy_queue.clear();
+        copy_queue.push_back(std::make_pair(new_root, top));
+        for (size_t i = 0; i < copy_queue.size(); ++i) {
+            uint32_t from = copy_queue[i].first, to = copy_queue[i].second;
+            uint32_t count = arena[from].num_children;
+            if (count == 0) {
+                continue;
+            }
+            uint32_t first = spare.allocate(count);
+            uint32_t old_first = arena[from].first_child;
+            spare[to].first_child = first;
+            for (uint32_t c = 0; c < count; ++c) {
+                spare[first + c] = arena[old_first + c];
+                copy_queue.push_back(std::make_pair(old_first + c, first + c));
+            }
+        }//time complexity=O(n) in the size of the subtree
+        std::swap(arena, spare);
+        spare.clear();
+        root = top;
+    }
+
+    // Step into child of the last node of the path, played by player
+    inline void descend(const uint32_t& child, Cell& player) {
+        size_t move = arena[child].move;
+        sim_cells[move] = player;
+        hashes.push_back(hashes.back() ^ zobrist.key(player, move) ^ zobrist.side());
+        player = opponent(player);
+        path.push_back(child);
+    }
+
+    // UCB1: unvisited children first, then wins/visits + c*sqrt(ln(N)/visits)
+    uint32_t select_child(const uint32_t& parent) {
+        const Node& p = arena[parent];
+        double log_parent = std::log(static_cast<double>(p.visits) + 1.0);
+        uint32_t best = p.first_child;
+        double best_value = -1.0;
+        for (uint32_t c = p.first_child; c < p.first_child + p.num_children; ++c) {
+            const Node& n = arena[c];
+            if (n.visits == 0 && (!rave || n.amaf_visits == 0)) {
+                return c;
+            }
+            double visits = static_cast<double>(n.visits);
+            double value;
+            if (rave) {
+                double amaf = n.amaf_wins / static_cast<double>(std::max<uint32_t>(n.amaf_visits, 1));
+                double beta = std::sqrt(rave_k / (3.0 * visits + rave_k));
+                double uct = n.visits ? n.wins / visits : 0.0;
+                value = (1.0 - beta) * uct + beta * amaf +
+                    exploration * std::sqrt(log_parent / (visits + 1.0));
+            }
+            else {
+                value = n.wins / visits + exploration * std::sqrt(log_parent / visits);
+            }
+            if (value > best_value) {
+                best_value = value;
+                best = c;
+            }
+        }
+        return best;
+    }
+
+    // AMAF update of the children of every node of the path, red holds the final fill
+    void update_amaf(const Cell& to_move, const Cell& winner) {
+        for (size_t depth = 0; depth < path.size(); ++depth) {
+            const Node& p = arena[path[depth]];
+            Cell player = depth % 2 ? opponent(to_move) : to_move;
+            bool player_red = player == Cell::Red;
+            float win = player == winner ? 1.0f : 0.0f;
+            for (uint32_t c = p.first_child; c < p.first_child + p.num_children; ++c) {
+                Node& n = arena[c];
+                if (bitboard.test(red, n.move) == player_red) {
+                    n.amaf_visits++;
+                    n.amaf_wins += win;
+                }
+            }
+        }//time complexity=O(n) per ply of the path
+    }
+
+    // One child per blank cell of sim_cells, false when full or no blank cell left.
+    // Children already met through another move order start from the table statistics.
+    bool expand(const uint32_t& node, const Cell& player) {
+        empties.clear();
+        for (auto v : root_blanks) {
+            if (sim_cells[v] == Cell::Blank) {
+                empties.push_back(v);
+            }
+        }
+        if (empties.empty() || arena.size() + empties.size() > max_nodes) {
+            return false;
+        }
+        uint32_t first = arena.allocate(empties.size());
+        for (size_t i = 0; i < empties.size(); ++i) {
+            Node& child = arena[first + static_cast<uint32_t>(i)];
+            child.move = static_cast<uint32_t>(empties[i]);
+            if (tt.enabled()) {
+                auto entry = tt.probe(hashes.back() ^ zobrist.key(player, empties[i]) ^ zobrist.side());
+                if (entry) {
+                    child.visits = entry->visits;
+                    child.wins = entry->wins;
+                }
+            }
+        }
+        arena[node].first_child = first;
+        arena[node].num_children = static_cast<uint32_t>(empties.size());
+        return true;
+    }
+
+    // Random fill of the blank cells, the player to move gets the extra cell
+    Cell playout(const Cell& to_move, Rng& rng) {
+        empties.clear();
+        red = base_red;
+        for (auto v : root_blanks) {
+            if (sim_cells[v] == Cell::Blank) {
+                empties.push_back(v);
+            }
+            else if (sim_cells[v] == Cell::Red) {
+                bitboard.set(red, v);
+            }
+        }
+        shuffle_range(empties.begin(), empties.end(), rng);
+        size_t mover_cells = (empties.size() + 1) / 2;
+        for (size_t i = 0; i < empties.size(); ++i) {
+            if ((i < mover_cells) == (to_move == Cell::Red)) {
+                bitboard.set(red, empties[i]);
+            }
+        }//time complexity=O(n)
+        return bitboard.connects_up_down(red, reach, next) ? Cell::Red : Cell::Blue;
+    }
+};
+//======================================================================================================
+// Time stamp counter when available, nanoseconds otherwise
+inline uint64_t read_cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(duration_cast<nanoseconds>(
+        steady_clock::now().time_since_epoch()).count());
+#endif
+}
+//======================================================================================================
+// Hex child class of Graph
+// See https://en.wikipedia.org/wiki/Hex_(board_game)
+// Pair (distance from source , node idx)
+/*Hex class uses graph class to build the game depending on the inputs from the user or the machine.*/
+typedef std::pair<float, size_t> ds_nidx;
+class Hex : public Graph {
+public:
+    Hex(const size_t size = 7, const bool HumanVsHuman = false)
+        : Graph(size* size), m_HvsH(HumanVsHuman), bitboard(size), sliced(size), zobrist(size* size), mcts(bitboard, zobrist, size* size), solver(size) {
+        num_cols = size;
+        Left_indexes.resize(num_cols);
+        // gen_shift generator function incrementing by first argument
+        // Starting at second argument.
+        gen_shift Left(num_cols, 0);
+        std::generate(Left_indexes.begin(), Left_indexes.end(), Left);
+        Right_indexes.resize(num_cols);
+        gen_shift Right(num_cols, num_cols - 1);
+        std::generate(Right_indexes.begin(), Right_indexes.end(), Right);
+
+        Up_indexes.resize(num_cols);
+        gen_shift Up(1, 0);
+        std::generate(Up_indexes.begin(), Up_indexes.end(), Up);
+        Down_indexes.resize(num_cols);
+        gen_shift Down(1, num_cols * (num_cols - 1));
+        std::generate(Down_indexes.begin(), Down_indexes.end(), Down);
+
+        game_table.resize(num_cols);
+        for (size_t i = 0; i < num_cols; ++i) {
+            game_table[i].assign(num_cols, blank);
+        }//time complexity=O(n)
+        game_it = 0;
+        previous_it = 0;
+
+        // Opposite side check existing, one flat array per color
+        for (auto& side : Opposites) {
+            side.assign(num_vertex, 0);
+        }
+
+        for (auto it = Right_indexes.begin(); it != Right_indexes.end(); ++it) {
+            Opposites[color(blue)][*it] = 1;
+        }//time complexity=O(n)
+
+        for (auto it = Down_indexes.begin(); it != Down_indexes.end(); ++it) {
+            Opposites[color(red)][*it] = 1;
+        }//time complexity=O(n)
+
+        hex_graph();
+        bridge_tables();
+        ring_tables();
+        // One set per cell plus the four borders
+        stones_set.reset(num_vertex + 4);
+    }
+
+    ~Hex() { stop_ponder(); }
+
+    // Number of threads sharing the Monte Carlo trials
+    inline void set_num_threads(const size_t& n) { num_threads = std::max<size_t>(n, 1); }
+
+    // Search on a background thread while the human is thinking (tree engines only)
+    inline void set_ponder(const bool& enabled) { ponder = enabled; }
+
+    // Thinking time per move or game clock, replaces num_trial when enabled
+    inline TimeManager& time_manager() { return clock; }
+
+    // Same seed, same thread count and same human moves replay the same game
+    inline void set_seed(const uint64_t& seed) { rng.seed(seed); }
+
+    // Flat Monte Carlo or tree search, num_trial is the number of playouts for both
+    inline void set_engine(const Engine& e) { engine = e; }
+    inline void set_kernel(const Kernel& k) { kernel = k; }
+    // Sequential halving needs a playout budget, with a clock uniform scoring is used
+    inline void set_allocation(const Allocation& a) { allocation = a; }
+    inline MCTS& tree_search() { return mcts; }
+    // Dead, captured and dominated cells are no candidates of the flat Monte Carlo
+    inline void set_prune(const bool& enabled) { prune = enabled; }
+    // No progress lines on stdout, for the text protocol
+    inline void set_quiet(const bool& q) { quiet = q; }
+    // Proof-number search once at most empties cells are blank, bounded in nodes and time
+    inline void set_solver(const size_t& empties, const size_t& max_nodes, const double& max_ms, const size_t& mb) {
+        solve_empties = empties;
+        solve_nodes = max_nodes;
+        solve_ms = max_ms;
+        solver.set_table_mb(mb);
+    }
+
+    // Forbid copy constructor since we do not want to use it here
+    Hex(const Hex&) = delete;
+    //---------------------------------------------------------------
+ /*Text of one cell, the only place where cells become strings.*/
+ const std::string& display_cell(const Cell& c) const {
+        static const std::array<std::string, 3> names = { {" . ", " X ", " O "} };
+        return names[color(c)];
+    }
+    //---------------------------------------------------------------
+ /*It shows how the game is displayed in terminal window. With coordinates the rows are
+ labeled from 1 and the columns with letters, as in move_name, else both from 0.*/   
+ void display_game(std::ostream& out = std::cout, const bool& coordinates = false) {
+        for (size_t i = 0; i < num_cols; ++i) {
+            out << std::string(2 * i, ' ');
+            for (size_t j = 0; j < num_cols; ++j) {
+                out << display_cell(game_table[i][j]);
+                if (j < num_cols - 1) {
+                    out << "-";
+                }
+            }
+            out << " " << (coordinates ? i + 1 : i);
+            if (i < num_cols - 1) {
+                out << "\n";
+                out << std::string(2 * i + 1, ' ');
+                std::generate_n(std::ostream_iterator<std::string>(out, ""),
+                    num_cols - 1, []() { return " \\ /"; });
+                out << " \\\n";
+            }
+            else { // Last line
+                out << "\n";
+                out << std::string(2 * (num_cols - 2) + 1, ' ');
+                for (size_t j = 0; j < num_cols; ++j) {
+                    out << "  " << (coordinates ? column_name(j) : std::to_string(j)) << " ";
+                }
+                out << "\n";
+            }
+        }//time complexity=O(n^2)
+    }/*Overall time complexity=O(n^2)*/
+    //-------------------------------------------------------------------------
+  /*Deciding the result of the game dpending on the various cases.*/  
+ bool game_over(std::string request_player, size_t num_trial) {
+
+        if (game_it == 0 && !m_HvsH) {
+            if (request_player == "x" || request_player == "X") {
+                first_player = 1;
+            }
+            else {
+                first_player = 0;
+            }
+        }
+
+        if (play(num_trial)) {
+            // Iteration just played
+            const Cell* current_player = previous_it % 2 ? &red : &blue;
+            bool connected = has_won(*current_player);
+#ifdef HEX_DEBUG_CHECKS
+            // Cross-check of the incremental sets with the graph search
+            assert(connected == UnionFind(previous_it % 2 ? Up_indexes : Left_indexes,
+                *current_player, vertices));
+#endif
+
+            if (connected) {
+                report_game(*current_player);
+                std::cout << "Game over, player " << display_cell(*current_player) << " wins!\n";
+                return true;
+            }
+
+            if (game_it >= num_vertex) {
+                std::cout << "Game over, draw game\n";
+                return true;
+            }
+
+            return false;
+
+        }
+        else { // If play
+            return false;
+        }
+    }
+
+    //-----------------------------------------------------
+    bool play(size_t num_trial) {
+        const Cell* current_player;
+        const std::string* current_path;
+        std::string player_input;
+        if (game_it == 0) {
+            display_game();
+        }
+        if (game_it % 2) {
+            current_player = &red;
+            current_path = &UpDown;
+        }
+        else {
+            current_player = &blue;
+            current_path = &LeftRight;
+        }
+        size_t col, row;
+
+        std::cout << "Iteration number " << game_it << "\n";
+        std::cout << "Player " << display_cell(*current_player) << ", path " << *current_path;
+        std::cout << " please enter (row,column)"
+            << "\n";
+        // First player may not be machine if = 1
+        if (m_HvsH || (game_it + first_player) % 2) {
+            if (!m_HvsH) {
+                start_ponder(*current_player);
+            }
+            PonderScope ponder_scope{ *this };
+            std::cin >> player_input;
+            if (!(std::stringstream(player_input) >> row)) {
+                std::cout << "Wrong input type, please enter \n";
+                std::cout << "only numbers (row enter, column enter).\n";
+                return false;
+            }
+            std::cin >> player_input;
+            if (!(std::stringstream(player_input) >> col)) {
+                std::cout << "Wrong input type, please enter number\n";
+                return false;
+            }
+            stop_ponder();
+
+            if (row >= num_cols || col >= num_cols) {
+
+                std::cout << "Illegal position," << display_cell(*current_player)
+                    << "please play again"
+                    << "\n";
+                return false;
+            }
+            if (game_it == 0) {
+                // Middle
+                inv_map[0] = (num_cols) / 2;
+                inv_map[1] = (num_cols) / 2;
+
+                int swap = book_swap(MapV(row, col));
+                if (swap == 1 || (swap < 0 && row == inv_map[0] && col == inv_map[1])) {
+                    first_player++;
+                    std::cout << "The machine has taken your position!\n";
+                }
+            }
+
+        }
+        else {
+            std::cout << "Simulation running, please wait...\n";
+            
+            size_t vertex_num = think(*current_player, num_trial);
+
+            std::cout << engine_name(engine) << " searched " << search.time_ms << " ms, "
+                << search.playouts << " playouts";
+            if (search.time_ms > 0) {
+                std::cout << " (" << static_cast<size_t>(1000.0 * static_cast<double>(search.playouts) / search.time_ms)
+                    << " playouts/s)";
+            }
+            if (search.tree_nodes > 0) {
+                std::cout << ", " << search.tree_nodes << " tree nodes";
+            }
+            std::cout << "\n";
+            if (clock.enabled()) {
+                std::cout << "time budget " << last_target_ms << " ms";
+                if (clock.remaining_ms() > 0) {
+                    std::cout << ", clock " << clock.remaining_ms() << " ms left";
+                }
+                std::cout << "\n";
+            }
+            if (engine != Engine::Flat) {
+                std::cout << "tree search reused " << mcts.reused_playouts()
+                    << " playouts from the previous moves\n";
+                TranspositionTable& tt = mcts.transpositions();
+                if (tt.enabled()) {
+                    std::cout << "transposition table: " << tt.hits << " hits, " << tt.misses
+                        << " misses, " << tt.collisions << " collisions\n";
+                }
+            }
+            
+            
+            inv_map = InvMapV(vertex_num);
+
+            row = inv_map[0];
+            col = inv_map[1];
+
+            if (game_it == 0) {
+
+                std::cout << "The machine has played "
+                    << "(" << row << "," << col << ")"
+                    << ".\n";
+                std::cout << "Would you like to take his position ? y(yes), n(no) \n";
+
+                std::string Input = "";
+                std::cin >> Input;
+                if (Input == "y" || Input == "Y") {
+                    first_player++;
+                    std::cout << "The human has taken your position\n";
+                }
+            }
+        }
+
+        if (place(MapV(row, col), *current_player)) {
+            std::cout << "Player " << display_cell(*current_player) << " has played "
+                << "(" << row << "," << col << ")"
+                << "\n";
+            display_game();
+            return true;
+        }
         else {
-            std::cout << "Illegal position," << *current_player << "please play again"
+            std::cout << "Illegal position," << display_cell(*current_player) << "please play again"
                 << "\n";
             return false;
         }
     }
     //-------------------------------------------------------------------------
+    /*Move of the machine for player with the selected engine, nothing is printed.
+    With the time manager enabled num_trial is ignored.*/
+    size_t think(const Cell& player, size_t num_trial) {
+        for (auto& w : workers) {
+            w.busy_ms = 0.0;
+        }
+        auto t0 = steady_clock::now();
+        float book_value = 0.0f;
+        size_t vertex_num = 0;
+        search.book = book_move(player, vertex_num, book_value);
+        search.proof = Proof::Unknown;
+        search.solver_nodes = 0;
+        // The solver is charged to the clock of the move like the search
+        if (!search.book && clock.enabled()) {
+            clock.start(game_it, num_vertex - game_it);
+        }
+        if (!search.book && num_vertex - game_it <= solve_empties) {
+            // With a clock the solver gets at most half of the move, the search the rest
+            double solver_ms = solve_ms;
+            if (clock.enabled()) {
+                double half = std::max(clock.target_ms() / 2.0, 1.0);
+                solver_ms = solver_ms > 0 ? std::min(solver_ms, half) : half;
+            }
+            Solver::Result proof = solver.solve(vertices, player, solve_nodes, solver_ms);
+            search.proof = proof.proof;
+            search.solver_nodes = proof.nodes;
+            if (proof.proof == Proof::Win) {
+                vertex_num = proof.move;
+            }
+            else if (proof.proof == Proof::Loss && !quiet) {
+                std::cout << "Position proven lost for " << display_cell(player) << "\n";
+            }
+        }
+        if (!search.book && search.proof != Proof::Win) {
+            last_halving = engine == Engine::Flat && allocation == Allocation::Halving && !clock.enabled();
+            vertex_num = engine != Engine::Flat
+                ? mcts.search(vertices, player, ponder_budget(num_trial, player), rng, position_hash,
+                    clock.enabled() ? &clock : nullptr)
+                : (allocation == Allocation::Halving && !clock.enabled())
+                ? SequentialHalving(player, num_trial)
+                : MonteCarlo(player, num_trial);
+        }
+        if (!search.book && clock.enabled()) {
+            last_target_ms = clock.target_ms();
+            clock.finish();
+        }
+        search.move = vertex_num;
+        search.time_ms = duration<double, std::milli>(steady_clock::now() - t0).count();
+        search.playouts = search.book || search.proof == Proof::Win ? 0 : last_playouts();
+        // The tree search runs on one thread
+        search.threads = engine == Engine::Flat ? std::max<size_t>(workers.size(), 1) : 1;
+        search.tree_nodes = engine == Engine::Flat ? 0 : mcts.tree_size();
+        search.utilization = 1.0;
+        if (engine == Engine::Flat && search.time_ms > 0) {
+            double busy = 0.0;
+            for (auto& w : workers) {
+                busy += w.busy_ms;
+            }
+            search.utilization = std::min(1.0, busy / (search.time_ms * static_cast<double>(search.threads)));
+        }
+        if (telemetry != nullptr && telemetry->enabled()) {
+            report_move(player, search.book ? book_value : search.proof == Proof::Win ? 1.0 : -1.0);
+        }
+        return vertex_num;
+    }
+
+    /*Exact outcome of the table for player to move with the solver limits.*/
+    Solver::Result solve(const Cell& player) {
+        return solver.solve(vertices, player, solve_nodes, solve_ms);
+    }
+
+    // Book of this table size, path may hold {size} for the dimension
+    bool load_book(std::string path) {
+        size_t at = path.find("{size}");
+        if (at != std::string::npos) {
+            path.replace(at, 6, std::to_string(num_cols));
+        }
+        return book.open(path, num_cols);
+    }
+
+    /*Book key of the table with player to move: a table and its 180 degree rotation (which
+    keeps the sides of each player) share the key, rotated tells which one was used.*/
+    inline uint64_t book_key(const Cell& player, bool& rotated) const {
+        rotated = rotated_hash < position_hash;
+        return (rotated ? rotated_hash : position_hash) ^ (player == red ? zobrist.side() : 0);
+    }
+
+    // Same cell after the 180 degree rotation
+    inline size_t rotate(const size_t& v) const { return num_vertex - 1 - v; }
+
+    /*Move and value of the book for player, false when the table is not in the book.*/
+    bool book_move(const Cell& player, size_t& v, float& value) const {
+        bool rotated;
+        uint32_t move;
+        if (!book.probe(book_key(player, rotated), move, value) || move >= num_vertex) {
+            return false;
+        }
+        v = rotated ? rotate(move) : move;
+        return vertices[v] == blank;
+    }
+
+    /*Swap decision when the human opened at u: 1 to take the stone, 0 not to, -1 when the
+    book does not know the position.*/
+    int book_swap(const size_t& u) {
+        if (!book.loaded() || u >= num_vertex || vertices[u] != blank) {
+            return -1;
+        }
+        vertices[u] = blue;
+        position_hash ^= zobrist.key(blue, u);
+        rotated_hash ^= zobrist.key(blue, rotate(u));
+        size_t v;
+        float value;
+        bool known = book_move(red, v, value);
+        vertices[u] = blank;
+        position_hash ^= zobrist.key(blue, u);
+        rotated_hash ^= zobrist.key(blue, rotate(u));
+        // The stone is worth taking when the reply is losing
+        return known ? value < 0.5f : -1;
+    }
+
+    // Value for player of a move of the last search, 0.5 when it was not scored
+    double move_value(const Cell& player, const size_t& move) const {
+        for (auto& entry : move_values(player)) {
+            if (entry.first == move) {
+                return entry.second;
+            }
+        }
+        return 0.5;
+    }
+
+    inline const SearchStats& last_search() const { return search; }
+
+    // Moves of this table are reported as game number game by engine label
+    inline void set_telemetry(Telemetry* t, const size_t& game, const std::string& label) {
+        telemetry = t;
+        telemetry_game = game;
+        telemetry_label = label;
+    }
+
+    // End of game line with the latency percentiles
+    void report_game(const Cell& winner) {
+        if (telemetry != nullptr && telemetry->enabled()) {
+            telemetry->game_over(telemetry_game, winner == blue ? "X" : "O");
+        }
+    }
+
+    /*Estimated win rate of player for the moves of the last search: root children of the
+    tree, win rate of the halving candidates, or for uniform flat Monte Carlo the mean
+    outcome of the playouts where player owned the cell.*/
+    std::vector<std::pair<size_t, double>> move_values(const Cell& player) const {
+        if (engine != Engine::Flat) {
+            return mcts.root_values();
+        }
+        std::vector<std::pair<size_t, double>> values;
+        size_t blanks = playout_blanks;
+        size_t stones = num_vertex - blanks;
+        size_t red_cells = (num_vertex + stones) / 2 - stones;
+        size_t own_cells = kernel == Kernel::Bridges ? (blanks + 1) / 2
+            : player == red ? red_cells : blanks - red_cells;
+        double per_cell = blanks ? static_cast<double>(last_trials * own_cells) / static_cast<double>(blanks) : 0.0;
+        for (size_t v = 0; v < num_vertex; ++v) {
+            if (!candidate(v)) {
+                continue;
+            }
+            if (last_halving && v < halving_plays.size() && halving_plays[v] > 0) {
+                values.emplace_back(v, static_cast<double>(halving_wins[v]) / static_cast<double>(halving_plays[v]));
+            }
+            else if (!last_halving && per_cell > 0 && v < win_prob.size()) {
+                double value = 0.5 + static_cast<double>(win_prob[v]) / (2.0 * per_cell);
+                values.emplace_back(v, std::min(1.0, std::max(0.0, value)));
+            }
+        }//time complexity is O(n)
+        return values;
+    }
+
+    /*Put a stone of player on the blank cell u, false when u is outside or taken.*/
+    bool place(const size_t& u, const Cell& player) {
+        if (u >= num_vertex || vertices[u] != blank) {
+            return false;
+        }
+        game_table[u / num_cols][u % num_cols] = player;
+        vertices[u] = player;
+        connect_stone(u, player);
+        position_hash ^= zobrist.key(player, u);
+        rotated_hash ^= zobrist.key(player, rotate(u));
+        if (engine != Engine::Flat) {
+            // Keep the statistics below the move actually played
+            mcts.advance(u, player);
+        }
+        history.push_back(u);
+        previous_it = game_it;
+        game_it++;
+        return true;
+    }//time complexity is O(1)
+
+    /*Take back the last stone, false on an empty table. The stone sets are rebuilt
+    since union-find cannot split, and the search tree is dropped.*/
+    bool undo() {
+        if (history.empty()) {
+            return false;
+        }
+        size_t u = history.back();
+        history.pop_back();
+        position_hash ^= zobrist.key(vertices[u], u);
+        rotated_hash ^= zobrist.key(vertices[u], rotate(u));
+        game_table[u / num_cols][u % num_cols] = blank;
+        vertices[u] = blank;
+        game_it--;
+        previous_it = game_it > 0 ? game_it - 1 : 0;
+        stones_set.reset(num_vertex + 4);
+        for (auto v : history) {
+            connect_stone(v, vertices[v]);
+        }//time complexity=O(n)
+        mcts.clear();
+        return true;
+    }
+
+    /*Drops what earlier searches learnt, tree, transposition table and solver table, so
+    the next search only depends on its position and the seed.*/
+    void forget_searches() {
+        mcts.forget();
+        solver.clear();
+    }
+
+    // Player joined his two sides
+    inline bool has_won(const Cell& player) {
+        return player == blue ? stones_set.same(LeftBorder(), RightBorder())
+            : stones_set.same(UpBorder(), DownBorder());
+    }
+
+    // Stones on the table, X always starts
+    inline size_t moves_played() const { return game_it; }
+    inline size_t dimension() const { return num_cols; }
+    inline bool is_blank(const size_t& v) const { return vertices[v] == blank; }
+    inline Cell to_move() const { return game_it % 2 ? red : blue; }
+
+    /*Text protocol coordinates: column letters (a..z, then aa, ab, ...) and row from 1,
+    "a1" is the upper left cell.*/
+    std::string move_name(const size_t& v) const {
+        return column_name(v % num_cols) + std::to_string(v / num_cols + 1);
+    }
+
+    // Letters of a column of the text protocol
+    static std::string column_name(const size_t& col) {
+        std::string letters;
+        for (size_t c = col + 1; c > 0; c = (c - 1) / 26) {
+            letters.insert(letters.begin(), static_cast<char>('a' + (c - 1) % 26));
+        }
+        return letters;
+    }
+
+    /*Inverse of move_name, false when the text is not a cell of this table.*/
+    bool parse_move(const std::string& text, size_t& v) const {
+        size_t i = 0, col = 0, row = 0;
+        for (; i < text.size() && std::isalpha(static_cast<unsigned char>(text[i])); ++i) {
+            col = col * 26 + static_cast<size_t>(std::tolower(static_cast<unsigned char>(text[i])) - 'a' + 1);
+        }
+        if (i == 0 || i == text.size() || i > 3) {
+            return false;
+        }
+        for (; i < text.size(); ++i) {
+            if (!std::isdigit(static_cast<unsigned char>(text[i])) || row > num_cols) {
+                return false;
+            }
+            row = row * 10 + static_cast<size_t>(text[i] - '0');
+        }
+        if (col < 1 || col > num_cols || row < 1 || row > num_cols) {
+            return false;
+        }
+        v = (row - 1) * num_cols + col - 1;
+        return true;
+    }
+    //-------------------------------------------------------------------------
+    /*Cycles per playout of the reference playout (vertices filled one by one and UnionFind)
+    and of the MonteCarlo playouts, measured on the current table.*/
+    void benchmark_playouts(size_t num_playouts) {
+        tmp_vertices = vertices;
+        Identity.assign(num_vertex, 0);
+        gen_shift Id(1, 0);
+        std::generate(Identity.begin(), Identity.end(), Id);
+        size_t middle_shuffle = (num_vertex + game_it) / 2;
+        Rng g(12345);
+        size_t red_wins = 0;
+
+        uint64_t start = read_cycles();
+        for (size_t trial = 0; trial < num_playouts; ++trial) {
+            shuffle_range(Identity.begin() + game_it, Identity.end(), g);
+            for (size_t map = game_it; map < num_vertex; ++map) {
+                tmp_vertices[Identity[map]] = map < middle_shuffle ? red : blue;
+            }
+            red_wins += UnionFind(Up_indexes, red, tmp_vertices);
+        }
+        uint64_t reference = read_cycles() - start;
+
+        Kernel chosen = kernel;
+        std::cout << "Hex dimension " << num_cols << ", " << num_playouts << " playouts\n";
+        std::cout << "reference playout (UnionFind): " << reference / num_playouts
+            << " cycles per playout (red wins " << red_wins << ")\n";
+        for (Kernel k : { Kernel::Bitboard, Kernel::Sliced, Kernel::Bridges }) {
+            kernel = k;
+            start = read_cycles();
+            auto t0 = steady_clock::now();
+            MonteCarlo(red, num_playouts);
+            uint64_t cycles = read_cycles() - start;
+            double seconds = duration<double>(steady_clock::now() - t0).count();
+            std::cout << "MonteCarlo playout (" << kernel_name(k)
+                << "): " << cycles / num_playouts << " cycles per playout, "
+                << static_cast<double>(num_playouts) / seconds << " playouts/s\n";
+        }
+        kernel = chosen;
+    }
+
+    /*Nanoseconds per UnionFind call on random full tables, half of the cells red.*/
+    double benchmark_union_find(const size_t& num_boards) {
+        Identity.assign(num_vertex, 0);
+        gen_shift Id(1, 0);
+        std::generate(Identity.begin(), Identity.end(), Id);
+        tmp_vertices.assign(num_vertex, blank);
+        Rng g(12345);
+        size_t red_wins = 0;
+        std::chrono::nanoseconds spent{ 0 };
+        for (size_t board = 0; board < num_boards; ++board) {
+            shuffle_range(Identity.begin(), Identity.end(), g);
+            for (size_t map = 0; map < num_vertex; ++map) {
+                tmp_vertices[Identity[map]] = map < num_vertex / 2 ? red : blue;
+            }
+            // Only the search is timed, not the filling
+            auto t0 = steady_clock::now();
+            red_wins += UnionFind(Up_indexes, red, tmp_vertices);
+            spent += steady_clock::now() - t0;
+        }//time complexity=O(n^3)
+        // Keeps the calls from being optimized away
+        return red_wins > num_boards ? 0.0
+            : static_cast<double>(spent.count()) / static_cast<double>(std::max<size_t>(num_boards, 1));
+    }
+
+    /*Winners of random full tables by every kernel against UnionFind, in batches of 64
+    tables with a random red density and a few stones placed first. The bitboard and the
+    sliced kernels decide the same tables, the bridge kernel fills one more table per batch
+    in turn. Returns the number of disagreements of each kernel, in Kernel order.*/
+    std::array<size_t, 3> check_kernels(const size_t& num_batches) {
+        std::array<size_t, 3> errors = { {0, 0, 0} };
+        workers.resize(1);
+        PlayoutWorker& w = workers[0];
+        w.rng = rng.split();
+        w.lanes.assign(num_vertex, 0);
+        w.where.resize(num_vertex);
+        for (size_t batch = 0; batch < num_batches; ++batch) {
+            unsigned threshold = w.rng.bounded(257);
+            for (auto& lane : w.lanes) {
+                lane = SlicedBoard::bernoulli(w.rng, threshold);
+            }
+            uint64_t sliced_wins = sliced.red_wins(w.lanes, w.lane_reach);
+            for (size_t game = 0; game < 64; ++game) {
+                bitboard.clear(w.fill_red);
+                tmp_vertices.assign(num_vertex, blue);
+                for (size_t v = 0; v < num_vertex; ++v) {
+                    if ((w.lanes[v] >> game) & 1) {
+                        tmp_vertices[v] = red;
+                        bitboard.set(w.fill_red, v);
+                    }
+                }//time complexity is O(n)
+                bool red_wins = UnionFind(Up_indexes, red, tmp_vertices);
+                // A full table has exactly one winner
+                errors[0] += red_wins == UnionFind(Left_indexes, blue, tmp_vertices);
+                errors[0] += red_wins != bitboard.connects_up_down(w.fill_red, w.reach, w.next);
+                errors[1] += red_wins != (((sliced_wins >> game) & 1) != 0);
+            }
+            // Bridge kernel game from a position of up to one stone per row
+            playout_cells.assign(num_vertex, blank);
+            bitboard.clear(base_red);
+            for (size_t stone = w.rng.bounded(static_cast<uint32_t>(num_cols + 1)); stone > 0; --stone) {
+                size_t v = w.rng.bounded(static_cast<uint32_t>(num_vertex));
+                playout_cells[v] = stone % 2 ? red : blue;
+            }
+            w.order.clear();
+            for (size_t v = 0; v < num_vertex; ++v) {
+                if (playout_cells[v] == blank) {
+                    w.order.push_back(static_cast<uint32_t>(v));
+                }
+                else if (playout_cells[v] == red) {
+                    bitboard.set(base_red, v);
+                }
+            }//time complexity is O(n)
+            bridge_fill(w, batch % 2 ? red : blue);
+            errors[2] += bitboard.connects_up_down(w.fill_red, w.reach, w.next)
+                != UnionFind(Up_indexes, red, std::vector<Cell>(w.board.begin(), w.board.end()));
+        }//time complexity is O(n^2) per batch
+        return errors;
+    }
+
+    // Playouts run by the last think()
+    inline size_t last_playouts() const {
+        return engine == Engine::Flat ? last_trials : mcts.last_playouts();
+    }
+    //-------------------------------------------------------------------------
 
     void print_hex_graph() {
         display_game();
@@ -418,7 +2893,7 @@ public:
     }
     //-----------------------------------------------------------------------------
 private:
-    std::vector<std::vector<std::string>> game_table;
+    std::vector<std::vector<Cell>> game_table;
     // Boarder indexes (Left,Right,Up,Down)
     std::vector<size_t> Left_indexes;  // Left side indexes
     std::vector<size_t> Right_indexes; // Rigth side
@@ -430,14 +2905,38 @@ private:
     inline size_t MapV(const size_t& row, const size_t& col) {
         return row * num_cols + col;
     }
+    // Union-find sets of the stones on the table, borders are the last four nodes
+    DisjointSet stones_set;
+    inline size_t LeftBorder() const { return num_vertex; }
+    inline size_t RightBorder() const { return num_vertex + 1; }
+    inline size_t UpBorder() const { return num_vertex + 2; }
+    inline size_t DownBorder() const { return num_vertex + 3; }
+    /*Join a new stone with its neighbors of the same color and with the borders of its player.*/
+    void connect_stone(const size_t& u, const Cell& player) {
+        for (auto v : neighbors(u)) {
+            if (vertices[v] == player) {
+                stones_set.unite(u, v);
+            }
+        }
+        size_t row = u / num_cols, col = u % num_cols;
+        if (player == blue) {
+            if (col == 0) stones_set.unite(u, LeftBorder());
+            if (col == num_cols - 1) stones_set.unite(u, RightBorder());
+        }
+        else {
+            if (row == 0) stones_set.unite(u, UpBorder());
+            if (row == num_cols - 1) stones_set.unite(u, DownBorder());
+        }
+    }//time complexity is O(1)
     std::array<size_t, 2> inv_map;
     inline std::array<size_t, 2> InvMapV(const size_t& v) {
         inv_map[0] = v / num_cols;
         inv_map[1] = v - inv_map[0] * num_cols;
         return inv_map;
     }
-    const std::string blue = " X ";
-    const std::string red = " O ";
+    const Cell blue = Cell::Blue;
+    const Cell red = Cell::Red;
+    static inline size_t color(const Cell& c) { return static_cast<size_t>(c); }
     size_t game_it;
     size_t previous_it;
     // Increment if order first player switched
@@ -459,7 +2958,7 @@ private:
         size_t m_stride, m_init;
     };
     //---------------------------------------------------------------------------------------
-    std::vector<std::string> tmp_vertices;
+    std::vector<Cell> tmp_vertices;
 
     std::vector<size_t> mapping;
     std::vector<size_t> Identity;
@@ -469,47 +2968,185 @@ private:
     // http://www.cplusplus.com/reference/queue/queue/pop/
     std::queue<size_t> PQ;
 
-    std::vector<long int> win_prob;
+    Counters win_prob;
 
-    std::unordered_map<std::string, std::vector<bool>> Opposites;
-
-    std::unordered_map<std::string, std::array<size_t, 2>> local_neighbors;
+    // Opposites[color][v] is 1 when v is on the arrival side of color
+    std::array<std::vector<unsigned char>, 3> Opposites;
     bool m_HvsH;
+    // Inferior cell analysis of the last flat Monte Carlo move
+    enum Inferior : unsigned char { Useful = 0, Dead = 1, CapturedBlue = 2, CapturedRed = 4, Dominated = 8 };
+    bool prune = false;
+    std::vector<unsigned char> inferior;
+    // Ring of the six neighbors of each cell, clockwise from up, BlueEdge or RedEdge off the table
+    static const int32_t BlueEdge = -1;
+    static const int32_t RedEdge = -2;
+    std::vector<std::array<int32_t, 6>> rings;
+    std::vector<Cell> analysis;
+    // Table the playouts start from: the stones and the captured cells
+    std::vector<Cell> playout_cells;
+    size_t playout_blanks = 0;
+    // Bridges of each carrier cell (CSR like the graph) and the answer rate over 256
+    std::vector<uint32_t> bridge_offsets;
+    std::vector<std::array<uint32_t, 3>> bridges;
+    const unsigned bridge_response = 240;
+    // Bit representation used by the playouts
+    BitBoard bitboard;
+    SlicedBoard sliced;
+    Kernel kernel = Kernel::Bitboard;
+    Allocation allocation = Allocation::Uniform;
+    Engine engine = Engine::Flat;
+    // Zobrist hash of the stones on the table, updated by every move
+    Zobrist zobrist;
+    uint64_t position_hash = 0;
+    // Hash of the table turned by 180 degrees, for the opening book
+    uint64_t rotated_hash = 0;
+    OpeningBook book;
+    MCTS mcts;
+    // Exact search below solve_empties blank cells, 0 never
+    Solver solver;
+    size_t solve_empties = 0;
+    size_t solve_nodes = 10000000;
+    double solve_ms = 0.0;
+    BitBoard::Words base_red;
+    /*State of one Monte Carlo worker thread, aligned on a cache line so that
+    two workers never write to the same line.*/
+    struct alignas(64) PlayoutWorker {
+        std::vector<size_t, CacheLineAllocator<size_t>> Identity;
+        BitBoard::Words fill_red;
+        BitBoard::Words reach;
+        BitBoard::Words next;
+        Counters win_prob;
+        Rng rng;
+        size_t trials_done;
+        SlicedBoard::Lanes lanes;
+        SlicedBoard::Lanes lane_reach;
+        // Sequential games of the bridge kernel
+        std::vector<Cell, CacheLineAllocator<Cell>> board;
+        std::vector<uint32_t, CacheLineAllocator<uint32_t>> order;
+        std::vector<uint32_t, CacheLineAllocator<uint32_t>> where;
+        double busy_ms = 0.0;
+    };
+    std::vector<PlayoutWorker> workers;
+    TimeManager clock;
+    // Budget of the last timed search, for the report after the move
+    double last_target_ms = 0.0;
+    // Stones in the order they were played, for undo
+    std::vector<size_t> history;
+    bool quiet = false;
+    SearchStats search;
+    // Scores of the last sequential halving, kept for the telemetry
+    bool last_halving = false;
+    std::vector<long int> halving_wins;
+    std::vector<long int> halving_plays;
+    Telemetry* telemetry = nullptr;
+    size_t telemetry_game = 0;
+    std::string telemetry_label;
+    /*Move line of the telemetry, the values are only computed when it is enabled. A book
+    or proven move comes with its known value and no alternatives.*/
+    void report_move(const Cell& player, const double& known_value) {
+        std::vector<std::pair<size_t, double>> values;
+        if (known_value >= 0) {
+            values.emplace_back(search.move, known_value);
+        }
+        else {
+            values = move_values(player);
+        }
+        std::stable_sort(values.begin(), values.end(),
+            [](const std::pair<size_t, double>& a, const std::pair<size_t, double>& b) { return a.second > b.second; });
+        double value = 0.0;
+        for (auto& entry : values) {
+            if (entry.first == search.move) {
+                value = entry.second;
+            }
+        }
+        std::vector<std::pair<std::string, double>> alternatives;
+        for (size_t k = 0; k < values.size() && k < telemetry->top(); ++k) {
+            alternatives.emplace_back(move_name(values[k].first), values[k].second);
+        }
+        telemetry->move(telemetry_game, telemetry_label, game_it, player == blue ? "X" : "O",
+            move_name(search.move), value, search, alternatives);
+    }
+    // Busy time of a worker, for the thread utilization
+    template <typename Work>
+    static void timed(PlayoutWorker& w, Work work) {
+        auto t0 = steady_clock::now();
+        work();
+        w.busy_ms += duration<double, std::milli>(steady_clock::now() - t0).count();
+    }
+    // Pondering thread and the number of playouts it ran before the human move
+    bool ponder = false;
+    bool pondering = false;
+    std::thread ponder_thread;
+    Rng ponder_rng;
+    /*Search the position with the human to move until the human move is read. The tree
+    then holds statistics for the human replies and the answers to them, and advance()
+    keeps the part below the reply actually played.*/
+    void start_ponder(const Cell& human) {
+        if (!ponder || engine == Engine::Flat || pondering) {
+            return;
+        }
+        ponder_rng = rng.split();
+        mcts.clear_stop();
+        pondering = true;
+        ponder_thread = std::thread([this, human]() {
+            mcts.search(vertices, human, std::numeric_limits<size_t>::max(), ponder_rng, position_hash);
+            });
+    }
+    // Playouts left to run when pondering already searched the current position
+    size_t ponder_budget(const size_t& num_trial, const Cell& player) const {
+        size_t warm = ponder ? mcts.root_playouts(vertices, player) : 0;
+        return num_trial > warm ? num_trial - warm : 0;
+    }
+    void stop_ponder() {
+        if (pondering) {
+            mcts.request_stop();
+            ponder_thread.join();
+            mcts.clear_stop();
+            pondering = false;
+        }
+    }
+    // Stops pondering on every way out of the human input
+    struct PonderScope {
+        Hex& hex;
+        ~PonderScope() { hex.stop_ponder(); }
+    };
+    // Raised by worker 0 when the clock stops the trials
+    std::atomic<bool> stop_trials{ false };
+    size_t last_trials = 0;
+    size_t num_threads = 1;
+    // Every worker stream is split from this generator, so a seed fixes the whole game
+    Rng rng;
     size_t num_cols;
     const float max_weight = 10.0;
-    const std::string Up = "Up";
-    const std::string Down = "Down";
-    const std::string Left = "Left";
-    const std::string Right = "Right";
-    const std::string RightUp = "RightUp";
-    const std::string DownLeft = "DownLeft";
+    enum Direction { Left, Right, Up, Down, RightUp, DownLeft, NumDirections };
+    typedef std::array<std::array<size_t, 2>, NumDirections> NeighborCoords;
 
     const std::string UpDown = "up-down";
     const std::string LeftRight = "left-right";
     // Array of dim (6,2) to generate neighboors of (rows,col) entries.
-    // Using strings for the 6 neighboors makes it more clear
+    // Naming the 6 neighboors makes it more clear
     // which (+,-) operation we are performing with a grid representation
-    inline std::unordered_map<std::string, std::array<size_t, 2>>
-        hex_neighbors(const size_t& row, const size_t& col) {
+    inline NeighborCoords hex_neighbors(const size_t& row, const size_t& col) const {
+        NeighborCoords local_neighbors;
         //(row,col-1)
         local_neighbors[Left][0] = row;
-        local_neighbors[Left][1] = std::max(static_cast<int>(col) - 1, 0);
+        local_neighbors[Left][1] = std::max(col, size_t(1)) - 1;
         //(row,col+1)
         local_neighbors[Right][0] = row;
         local_neighbors[Right][1] = std::min(col + 1, num_cols - 1);
         //(row-1,col)
-        local_neighbors[Up][0] = std::max(static_cast<int>(row) - 1, 0);
+        local_neighbors[Up][0] = std::max(row, size_t(1)) - 1;
         local_neighbors[Up][1] = col;
         //(row+1,col)
         local_neighbors[Down][0] = std::min(row + 1, num_cols - 1);
         local_neighbors[Down][1] = col;
 
         //(row-1,col+1)
-        local_neighbors[RightUp][0] = std::max(static_cast<int>(row) - 1, 0);
+        local_neighbors[RightUp][0] = std::max(row, size_t(1)) - 1;
         local_neighbors[RightUp][1] = std::min(col + 1, num_cols - 1);
         //(row+1,col-1)
         local_neighbors[DownLeft][0] = std::min(row + 1, num_cols - 1);
-        local_neighbors[DownLeft][1] = std::max(static_cast<int>(col) - 1, 0);
+        local_neighbors[DownLeft][1] = std::max(col, size_t(1)) - 1;
 
         return local_neighbors;
     }
@@ -518,26 +3155,219 @@ private:
         for (size_t row = 0; row < num_cols; ++row) {
             for (size_t col = 0; col < num_cols; ++col) {
 
-                local_neighbors = hex_neighbors(row, col);
+                auto local_neighbors = hex_neighbors(row, col);
 
                 auto u = MapV(row, col);
 
-                for (auto row_col : local_neighbors) {
-                    assert(row_col.second[0] < num_cols && row_col.second[0] < num_cols &&
+                for (auto& row_col : local_neighbors) {
+                    assert(row_col[0] < num_cols && row_col[1] < num_cols &&
                         "Problem i,j");
-                    auto v = MapV(row_col.second[0], row_col.second[1]);
+                    auto v = MapV(row_col[0], row_col[1]);
                     if (u != v) {
                         assert(u < num_vertex&& v < num_vertex && "Problem mapping");
-                        add_edge(u, v);
-                        set_edge_value(u, v, max_weight);
                         // All edges set to max_weight
                         // Set to zero when one connection created
+                        add_edge(u, v, max_weight);
                     }
                 }//time complexity is O(n)
             }//time complexity is O(n)
         }//time complexity is O(n)
-        
-    }//worst case scenario is O(n^3)
+        compress();
+
+    }//overall time complexity is O(n) with the counting sort of the edge list
+    //---------------------------------------------------------------------------------------
+    /*Bridges by carrier cell: two stones u and w that are not adjacent but have two common
+    neighbors c and d are connected unless both c and d are taken. For each cell c the
+    table lists the (u, w, d) of the bridges carried by c, found from the graph neighbors.*/
+    void bridge_tables() {
+        bridge_offsets.assign(num_vertex + 1, 0);
+        bridges.clear();
+        for (size_t c = 0; c < num_vertex; ++c) {
+            bridge_offsets[c] = static_cast<uint32_t>(bridges.size());
+            auto ring = neighbors(c);
+            for (auto u = ring.begin(); u != ring.end(); ++u) {
+                for (auto w = u + 1; w != ring.end(); ++w) {
+                    if (adjacent(*u, *w)) {
+                        continue;
+                    }
+                    for (auto d : ring) {
+                        if (d != *u && d != *w && adjacent(d, *u) && adjacent(d, *w)) {
+                            bridges.push_back({ { static_cast<uint32_t>(*u), static_cast<uint32_t>(*w),
+                                static_cast<uint32_t>(d) } });
+                        }
+                    }
+                }
+            }//time complexity is O(1), six neighbors
+        }//time complexity is O(n)
+        bridge_offsets[num_vertex] = static_cast<uint32_t>(bridges.size());
+    }
+
+    //---------------------------------------------------------------------------------------
+    void ring_tables() {
+        rings.resize(num_vertex);
+        const int n = static_cast<int>(num_cols);
+        const int dr[6] = { -1, -1, 0, 1, 1, 0 };
+        const int dc[6] = { 0, 1, 1, 0, -1, -1 };
+        for (size_t v = 0; v < num_vertex; ++v) {
+            int row = static_cast<int>(v / num_cols), col = static_cast<int>(v % num_cols);
+            for (size_t k = 0; k < 6; ++k) {
+                int r = row + dr[k], c = col + dc[k];
+                if (r < 0 || r >= n) {
+                    rings[v][k] = RedEdge;
+                }
+                else if (c < 0 || c >= n) {
+                    rings[v][k] = BlueEdge;
+                }
+                else {
+                    rings[v][k] = r * n + c;
+                }
+            }
+        }//time complexity=O(n)
+    }
+
+    /*Rings in base 3, digit k for the ring cell k: 0 blank, 1 stone or edge of the player,
+    2 stone or edge of the other player. A cell is useless to the player when, for every
+    color of the blank ring cells, the ring cells of the player form at most one arc: a stone
+    there joins nothing that is not joined already.*/
+    static const std::array<bool, 729>& useless_rings() {
+        static const std::array<bool, 729> table = []() {
+            std::array<bool, 729> t{};
+            for (size_t code = 0; code < t.size(); ++code) {
+                std::array<size_t, 6> digit{};
+                std::vector<size_t> free_cells;
+                for (size_t k = 0, x = code; k < 6; ++k, x /= 3) {
+                    digit[k] = x % 3;
+                    if (digit[k] == 0) {
+                        free_cells.push_back(k);
+                    }
+                }
+                bool useless = true;
+                for (size_t mask = 0; useless && mask < (size_t(1) << free_cells.size()); ++mask) {
+                    std::array<bool, 6> own{};
+                    for (size_t k = 0; k < 6; ++k) {
+                        own[k] = digit[k] == 1;
+                    }
+                    for (size_t i = 0; i < free_cells.size(); ++i) {
+                        own[free_cells[i]] = own[free_cells[i]] || ((mask >> i) & 1);
+                    }
+                    size_t arcs = 0;
+                    for (size_t k = 0; k < 6; ++k) {
+                        arcs += own[k] && !own[(k + 5) % 6];
+                    }
+                    useless = arcs <= 1;
+                }
+                t[code] = useless;
+            }
+            return t;
+        }();
+        return table;
+    }
+
+    inline bool useless(const std::vector<Cell>& board, const size_t& v, const Cell& player) const {
+        size_t code = 0;
+        for (size_t k = 6; k-- > 0;) {
+            int32_t u = rings[v][k];
+            Cell c = u >= 0 ? board[static_cast<size_t>(u)] : (u == BlueEdge ? blue : red);
+            code = code * 3 + (c == blank ? 0 : (c == player ? 1 : 2));
+        }
+        return useless_rings()[code];
+    }
+
+    // Neither color of v can change the winner
+    inline bool dead(const std::vector<Cell>& board, const size_t& v) const {
+        return useless(board, v, blue) && useless(board, v, red);
+    }
+
+    // Where the two edges meet the ring is ambiguous
+    inline bool corner(const size_t& v) const {
+        size_t row = v / num_cols, col = v % num_cols;
+        return (row == 0 || row == num_cols - 1) && (col == 0 || col == num_cols - 1);
+    }
+
+    /*Marks the blank cells that are no better than another move for mover, from the ring
+    of each cell, the edges counting as stones of their owner:
+    dead, neither color there can matter;
+    captured by a player, two adjacent blank cells where a stone of that player on either
+    one kills the other, so the player answers an intrusion and owns both;
+    dominated, a stone of mover on a blank neighbor kills the cell, which makes that
+    neighbor at least as good as the cell itself.
+    Nothing is marked when every blank cell would be.*/
+    void inferior_cells(const Cell& mover) {
+        inferior.assign(num_vertex, Useful);
+        analysis = vertices;
+        for (size_t v = 0; v < num_vertex; ++v) {
+            if (analysis[v] == blank && !corner(v) && dead(analysis, v)) {
+                inferior[v] = Dead;
+            }
+        }//time complexity is O(n)
+        auto free_cell = [&](const size_t& v) {
+            return analysis[v] == blank && inferior[v] == Useful && !corner(v);
+        };
+        for (size_t v = 0; v < num_vertex; ++v) {
+            for (Cell player : { blue, red }) {
+                if (!free_cell(v)) {
+                    break;
+                }
+                for (auto d : neighbors(v)) {
+                    if (d < v || !free_cell(d)) {
+                        continue;
+                    }
+                    analysis[d] = player;
+                    bool kills_v = dead(analysis, v);
+                    analysis[d] = blank;
+                    analysis[v] = player;
+                    bool kills_d = kills_v && dead(analysis, d);
+                    analysis[v] = blank;
+                    if (kills_d) {
+                        unsigned char owner = player == blue ? CapturedBlue : CapturedRed;
+                        inferior[v] = inferior[d] = owner;
+                        break;
+                    }
+                }
+            }
+        }//time complexity is O(n)
+        for (size_t v = 0; v < num_vertex; ++v) {
+            if (!free_cell(v)) {
+                continue;
+            }
+            for (auto d : neighbors(v)) {
+                // The dominating cell stays a candidate
+                if (analysis[d] != blank || inferior[d] != Useful) {
+                    continue;
+                }
+                analysis[d] = mover;
+                bool kills_v = dead(analysis, v);
+                analysis[d] = blank;
+                if (kills_v) {
+                    inferior[v] = Dominated;
+                    break;
+                }
+            }
+        }//time complexity is O(n)
+        bool any_candidate = false;
+        for (size_t v = 0; v < num_vertex; ++v) {
+            any_candidate = any_candidate || (vertices[v] == blank && inferior[v] == Useful);
+        }
+        if (!any_candidate) {
+            inferior.assign(num_vertex, Useful);
+        }
+    }
+
+    // Blank cell worth a playout statistic
+    inline bool candidate(const size_t& v) const {
+        return vertices[v] == blank && (!prune || v >= inferior.size() || inferior[v] == Useful);
+    }
+
+    // Second carrier of a bridge of player broken into at c, num_vertex if none
+    inline size_t bridge_save(const Cell* board, const size_t& c, const Cell& player) const {
+        for (uint32_t i = bridge_offsets[c]; i < bridge_offsets[c + 1]; ++i) {
+            const auto& b = bridges[i];
+            if (board[b[0]] == player && board[b[1]] == player && board[b[2]] == blank) {
+                return b[2];
+            }
+        }
+        return num_vertex;
+    }
     //---------------------------------------------------------------------------------------
     void clear_queue(std::queue<size_t>& q) {
         if (!q.empty()) {
@@ -548,12 +3378,13 @@ private:
     //---------------------------------------------------------------------------------------
       /* union–find data structure is used for Finding shortest paths from src to all other vertices. */
     bool UnionFind(const std::vector<size_t>& BorderMin,
-        const std::string& current_player,
-        const std::vector<std::string>& vertice_name) {
+        const Cell& current_player,
+        const std::vector<Cell>& vertice_name) {
 
         clear_queue(PQ);
         // Initialize checked edges to false : no neighbor checked yet
         checked.assign(num_vertex, false);
+        const std::vector<unsigned char>& opposite = Opposites[color(current_player)];
         // Start from all potential sources
         for (auto pt_src = BorderMin.begin(); pt_src != BorderMin.end(); ++pt_src) {
             if (vertice_name[*pt_src] == current_player) {
@@ -567,9 +3398,9 @@ private:
                         continue;
                     }
                     checked[u] = true;
-                    for (auto v : neighbors[u]) {
+                    for (auto v : neighbors(u)) {
                         if (vertice_name[v] == current_player) {
-                            if (Opposites[current_player][v]) {
+                            if (opposite[v]) {
                                 return true;
                             }
                             PQ.push(v);
@@ -582,48 +3413,163 @@ private:
         //worst case scenario is O(n^3)
     }
 //-----------------------------------------------------------------------------------------
-    size_t MonteCarlo(const std::string current_player, size_t num_trial) {
+    size_t MonteCarlo(const Cell current_player, size_t num_trial) {
         tmp_vertices.assign(num_vertex, blank);
         win_prob.assign(num_vertex, 0);
         mapping.assign(num_vertex, 0);
-
-        Identity.assign(num_vertex, 0);
-        // Id mapping
-        gen_shift Id(1, 0); // 0,1,2,3...
-        std::generate(Identity.begin(), Identity.end(), Id);
+        // Captured cells start the playouts filled for their owner
+        playout_cells = vertices;
+        if (prune) {
+            inferior_cells(current_player);
+            for (size_t map = 0; map < num_vertex; ++map) {
+                if (inferior[map] & CapturedBlue) {
+                    playout_cells[map] = blue;
+                }
+                else if (inferior[map] & CapturedRed) {
+                    playout_cells[map] = red;
+                }
+            }//time complexity is O(n)
+        }
 
         size_t count_non_blank = 0;
-        size_t count_blank = game_it;
-        for (size_t map = 0; map < vertices.size(); ++map) {
-            if (vertices[map] != blank) {
-                tmp_vertices[map] = vertices[map];
-                mapping[count_non_blank] = map;
-                count_non_blank++;
+        for (size_t map = 0; map < num_vertex; ++map) {
+            count_non_blank += playout_cells[map] != blank;
+        }
+        assert(count_non_blank >= game_it);
+        playout_blanks = num_vertex - count_non_blank;
+        size_t count_stones = 0;
+        size_t count_blank = count_non_blank;
+        for (size_t map = 0; map < playout_cells.size(); ++map) {
+            if (playout_cells[map] != blank) {
+                tmp_vertices[map] = playout_cells[map];
+                mapping[count_stones] = map;
+                count_stones++;
             }
             else {
                 mapping[count_blank] = map;
                 count_blank++;
             }
         }//time complexity is O(n)
-        assert(game_it == count_non_blank);
 
-        size_t middle_shuffle = (vertices.size() + count_non_blank) / 2;
+        size_t middle_shuffle = (playout_cells.size() + count_non_blank) / 2;
+
+        // Stones already played by red are the same for every trial
+        bitboard.clear(base_red);
+        for (size_t map = 0; map < playout_cells.size(); ++map) {
+            if (playout_cells[map] == red) {
+                bitboard.set(base_red, map);
+            }
+        }//time complexity is O(n)
+
+        // With a clock every worker runs until worker 0 sees the time is over
+        if (clock.enabled()) {
+            num_trial = std::numeric_limits<size_t>::max();
+        }
+        stop_trials = false;
+
+        // Split the trials over the workers, worker 0 runs on this thread
+        size_t num_workers = std::max<size_t>(1, std::min(num_threads, num_trial));
+#ifdef HEX_DEBUG_CHECKS
+        num_workers = 1; // UnionFind reference check is not thread safe
+#endif
+        workers.resize(num_workers);
+        std::vector<std::thread> pool;
+        size_t main_trials = 0;
+        for (size_t w = 0; w < num_workers; ++w) {
+            workers[w].rng = rng.split();
+            size_t trials = clock.enabled() ? num_trial
+                : num_trial / num_workers + (w < num_trial % num_workers);
+            if (w == 0) {
+                main_trials = trials;
+                continue;
+            }
+            pool.emplace_back([this, w, trials, current_player, count_non_blank, middle_shuffle]() {
+                timed(workers[w], [&]() {
+                    run_trials(workers[w], current_player, trials, count_non_blank, middle_shuffle);
+                    });
+                });
+        }
+        timed(workers[0], [&]() {
+            run_trials(workers[0], current_player, main_trials, count_non_blank, middle_shuffle);
+            });
+        for (auto& t : pool) {
+            t.join();
+        }
+        // Reduction of the per worker accumulators
+        last_trials = 0;
+        for (auto& w : workers) {
+            for (size_t map = 0; map < num_vertex; ++map) {
+                win_prob[map] += w.win_prob[map];
+            }
+            last_trials += w.trials_done;
+        }//time complexity is O(n)
 
-        std::random_device rd;
-        std::mt19937 g(rd());
-        for (size_t trial = 0; trial < num_trial; trial++) {
-            std::shuffle(Identity.begin() + count_non_blank, Identity.end(), g);
+        // All accumulated sum are minimaly equal to -num_trial
+        long int max = std::numeric_limits<long int>::min();
+        size_t v_sol = 0;
+        // Select among unselected vertices
+        for (size_t map = 0; map < vertices.size(); ++map) {
+            if (candidate(map) && win_prob[map] > max) {
+                max = win_prob[map];
+                v_sol = map;
+            }
+        }
+        return v_sol;
+        //worst case scenario is complexity of order (n^2)
+    }
+    //-----------------------------------------------------------------------------------------
+    /*Trials of one worker: random fill of the blank cells, winner from the bitboard and
+    win_prob update of the filled cells. Only reads the shared MonteCarlo state.*/
+    void run_trials(PlayoutWorker& w, const Cell current_player, size_t num_trial,
+        size_t count_non_blank, size_t middle_shuffle) {
+        w.win_prob.assign(num_vertex, 0);
+        if (kernel == Kernel::Sliced) {
+            run_sliced_trials(w, current_player, num_trial, count_non_blank, middle_shuffle);
+            return;
+        }
+        if (kernel == Kernel::Bridges) {
+            run_bridge_trials(w, current_player, num_trial, count_non_blank);
+            return;
+        }
+        auto& Identity = w.Identity;
+        Identity.resize(num_vertex);
+        gen_shift Id(1, 0); // 0,1,2,3...
+        std::generate(Identity.begin(), Identity.end(), Id);
+        Counters& win_prob = w.win_prob;
+        bool leader = &w == &workers[0];
+        size_t trial = 0;
+        for (; trial < num_trial; trial++) {
+            if (clock.enabled() && trial % 16 == 0) {
+                if (leader && clock.should_stop(best_blank(win_prob, count_non_blank))) {
+                    stop_trials = true;
+                }
+                if (stop_trials) {
+                    break;
+                }
+            }
+            shuffle_range(Identity.begin() + count_non_blank, Identity.end(), w.rng);
             // Need to assign each remaining vertex, red lower number since start
             // in second.
+            w.fill_red = base_red;
             for (size_t map = count_non_blank; map < middle_shuffle; ++map) {
-                tmp_vertices[mapping[Identity[map]]] = red;
+                bitboard.set(w.fill_red, mapping[Identity[map]]);
             }//time complexity is O(n)
-            
-            for (size_t map = middle_shuffle; map < vertices.size(); ++map) {
+
+            // Full board: red connects up-down or blue connects left-right
+            bool red_wins = bitboard.connects_up_down(w.fill_red, w.reach, w.next);
+#ifdef HEX_DEBUG_CHECKS
+            // Reference check of the bitboard against the graph search
+            for (size_t map = count_non_blank; map < middle_shuffle; ++map) {
+                tmp_vertices[mapping[Identity[map]]] = red;
+            }
+            for (size_t map = middle_shuffle; map < num_vertex; ++map) {
                 tmp_vertices[mapping[Identity[map]]] = blue;
-            }//time complexity is O(n)
+            }
+            assert(red_wins == UnionFind(Up_indexes, red, tmp_vertices));
+            assert(red_wins != UnionFind(Left_indexes, blue, tmp_vertices));
+#endif
 
-            if (UnionFind(Up_indexes, red, tmp_vertices)) {
+            if (red_wins) {
                 // Increment indexes corresponding to red win
                 if (current_player == red) { // Red win
                     for (size_t map = count_non_blank; map < middle_shuffle; ++map) {
@@ -631,14 +3577,14 @@ private:
                     }//time complexity is O(n)
                 }
                 else { // Blue lost
-                    for (auto map = middle_shuffle; map < vertices.size(); ++map) {
+                    for (auto map = middle_shuffle; map < num_vertex; ++map) {
                         win_prob[mapping[Identity[map]]]--;
                     }//time complexity is O(n)
                 }
             }
             else {
                 if (current_player == blue) { // Blue win
-                    for (auto map = middle_shuffle; map < vertices.size(); ++map) {
+                    for (auto map = middle_shuffle; map < num_vertex; ++map) {
                         win_prob[mapping[Identity[map]]]++;
                     }//time complexity is O(n)
 
@@ -650,23 +3596,270 @@ private:
                 }
             }
         }//time complexity is O(n)
-        
-        // All accumulated sum are minimaly equal to -num_trial
-        long int max = -static_cast<long int>(num_trial);
-        size_t v_sol = 0;
-        // Select among unselected vertices
-        for (size_t map = 0; map < vertices.size(); ++map) {
-            if (vertices[map] == blank && win_prob[map] > max) {
-                max = win_prob[map];
-                v_sol = map;
+        w.trials_done = trial;
+    }
+    //-----------------------------------------------------------------------------------------
+    /*Trials of one worker by batches of 64 bit sliced games. Each blank cell is red with
+    probability (middle_shuffle - count_non_blank) / blanks in every game, which gives red
+    the same expected number of cells as the shuffle. win_prob is updated from the masks:
+    cells of the player to move count +1 in the games it wins and -1 in the games it loses.*/
+    void run_sliced_trials(PlayoutWorker& w, const Cell current_player, size_t num_trial,
+        size_t count_non_blank, size_t middle_shuffle) {
+        Counters& win_prob = w.win_prob;
+        size_t blanks = num_vertex - count_non_blank;
+        unsigned threshold = blanks ? static_cast<unsigned>(
+            (256 * (middle_shuffle - count_non_blank) + blanks / 2) / blanks) : 0;
+        w.lanes.assign(num_vertex, 0);
+        for (size_t map = 0; map < num_vertex; ++map) {
+            if (playout_cells[map] == red) {
+                w.lanes[map] = ~uint64_t(0);
+            }
+        }
+        bool leader = &w == &workers[0];
+        size_t trial = 0;
+        for (; trial < num_trial; trial += 64) {
+            if (clock.enabled()) {
+                if (leader && clock.should_stop(best_blank(win_prob, count_non_blank))) {
+                    stop_trials = true;
+                }
+                if (stop_trials) {
+                    break;
+                }
+            }
+            // The last batch only keeps the games still owed
+            uint64_t used = num_trial - trial >= 64 ? ~uint64_t(0)
+                : (uint64_t(1) << (num_trial - trial)) - 1;
+            for (size_t map = count_non_blank; map < num_vertex; ++map) {
+                w.lanes[mapping[map]] = SlicedBoard::bernoulli(w.rng, threshold);
+            }
+            uint64_t red_wins = sliced.red_wins(w.lanes, w.lane_reach);
+            uint64_t mover_wins = (current_player == red ? red_wins : ~red_wins) & used;
+            uint64_t mover_loses = ~mover_wins & used;
+            for (size_t map = count_non_blank; map < num_vertex; ++map) {
+                size_t v = mapping[map];
+                uint64_t mover_cells = current_player == red ? w.lanes[v] : ~w.lanes[v];
+                win_prob[v] += static_cast<long int>(__builtin_popcountll(mover_cells & mover_wins)) -
+                    static_cast<long int>(__builtin_popcountll(mover_cells & mover_loses));
+            }//time complexity is O(n)
+        }
+        w.trials_done = std::min(trial, num_trial);
+    }
+    //-----------------------------------------------------------------------------------------
+    /*Trials of one worker as games in turn on the shuffled blank cells, the player to move
+    first. When a move breaks into a bridge of the other player, the other player answers on
+    its second carrier with probability bridge_response/256 instead of the next cell of the
+    order, so the playouts do not lose the connections any player would keep. Cells of the
+    player to move count +1 in the games it wins and -1 in the games it loses.*/
+    void run_bridge_trials(PlayoutWorker& w, const Cell current_player, size_t num_trial,
+        size_t count_non_blank) {
+        Counters& win_prob = w.win_prob;
+        size_t blanks = num_vertex - count_non_blank;
+        w.order.resize(blanks);
+        w.where.resize(num_vertex);
+        for (size_t k = 0; k < blanks; ++k) {
+            w.order[k] = static_cast<uint32_t>(mapping[count_non_blank + k]);
+        }
+        bool leader = &w == &workers[0];
+        size_t trial = 0;
+        for (; trial < num_trial; trial++) {
+            if (clock.enabled() && trial % 16 == 0) {
+                if (leader && clock.should_stop(best_blank(win_prob, count_non_blank))) {
+                    stop_trials = true;
+                }
+                if (stop_trials) {
+                    break;
+                }
+            }
+            bridge_fill(w, current_player);
+            bool red_wins = bitboard.connects_up_down(w.fill_red, w.reach, w.next);
+#ifdef HEX_DEBUG_CHECKS
+            assert(red_wins == UnionFind(Up_indexes, red, std::vector<Cell>(w.board.begin(), w.board.end())));
+#endif
+            long int score = red_wins == (current_player == red) ? 1 : -1;
+            for (size_t k = 0; k < blanks; k += 2) {
+                win_prob[w.order[k]] += score;
+            }//time complexity is O(n)
+        }
+        w.trials_done = std::min(trial, num_trial);
+    }
+
+    /*One game in turn of the bridge kernel from playout_cells and base_red, on the blank
+    cells of w.order: the filled table in w.board and its red stones in w.fill_red.*/
+    void bridge_fill(PlayoutWorker& w, const Cell& first) {
+        size_t blanks = w.order.size();
+        shuffle_range(w.order.begin(), w.order.end(), w.rng);
+        for (size_t k = 0; k < blanks; ++k) {
+            w.where[w.order[k]] = static_cast<uint32_t>(k);
+        }
+        w.board.assign(playout_cells.begin(), playout_cells.end());
+        w.fill_red = base_red;
+        Cell mover = first;
+        for (size_t k = 0; k < blanks; ++k) {
+            size_t v = w.order[k];
+            w.board[v] = mover;
+            if (mover == red) {
+                bitboard.set(w.fill_red, v);
+            }
+            mover = opponent(mover);
+            size_t save = bridge_save(w.board.data(), v, mover);
+            if (save < num_vertex && w.rng.bounded(256) < bridge_response) {
+                // Bring the answer to the next place of the order
+                size_t j = w.where[save];
+                std::swap(w.order[k + 1], w.order[j]);
+                w.where[w.order[j]] = static_cast<uint32_t>(j);
+                w.where[save] = static_cast<uint32_t>(k + 1);
+            }
+        }//time complexity is O(n)
+    }
+    //-----------------------------------------------------------------------------------------
+    /*Sequential halving of num_trial playouts over the first moves: every round gets the
+    same share of the budget, spread evenly over the remaining candidates, which play their
+    cell then a random fill. The better half by win rate goes to the next round, so after
+    about log2(blanks) rounds most playouts went to the few contenders.*/
+    size_t SequentialHalving(const Cell current_player, size_t num_trial) {
+        std::vector<size_t> candidates, blanks;
+        bitboard.clear(base_red);
+        if (prune) {
+            inferior_cells(current_player);
+        }
+        for (size_t map = 0; map < num_vertex; ++map) {
+            if (vertices[map] == blank) {
+                blanks.push_back(map);
+                if (candidate(map)) {
+                    candidates.push_back(map);
+                }
+            }
+            else if (vertices[map] == red) {
+                bitboard.set(base_red, map);
+            }
+        }//time complexity is O(n)
+        std::vector<long int>& wins = halving_wins;
+        std::vector<long int>& plays = halving_plays;
+        wins.assign(num_vertex, 0);
+        plays.assign(num_vertex, 0);
+        last_trials = 0;
+        if (candidates.size() > num_trial) {
+            // A random subset small enough for one playout each in the first round and a
+            // budget left for the next ones
+            shuffle_range(candidates.begin(), candidates.end(), rng);
+            candidates.resize(std::max<size_t>(num_trial / 2, 1));
+        }
+        if (candidates.size() <= 1) {
+            return candidates.empty() ? 0 : candidates[0];
+        }
+        size_t rounds = 0;
+        while ((size_t(1) << rounds) < candidates.size()) {
+            rounds++;
+        }
+        size_t num_workers = std::max<size_t>(1, num_threads);
+        workers.resize(num_workers);
+        for (auto& w : workers) {
+            w.rng = rng.split();
+        }
+
+        size_t spent = 0;
+        for (size_t round = 0; round < rounds && candidates.size() > 1; ++round) {
+            // What is left of the budget is shared by the rounds left, every candidate
+            // plays at least once per round; when that no longer fits the candidates keep
+            // the ranking of the rounds already played
+            size_t left = num_trial - spent;
+            if (left < candidates.size()) {
+                break;
+            }
+            size_t per_candidate = std::max<size_t>(1, left / (rounds - round) / candidates.size());
+            spent += per_candidate * candidates.size();
+            // Candidates i, i + num_workers, ... go to worker i
+            std::vector<std::thread> pool;
+            for (size_t w = 1; w < num_workers; ++w) {
+                pool.emplace_back([&, w]() {
+                    timed(workers[w], [&]() {
+                        halving_trials(workers[w], w, num_workers, candidates, blanks, current_player, per_candidate);
+                        });
+                    });
+            }
+            timed(workers[0], [&]() {
+                halving_trials(workers[0], 0, num_workers, candidates, blanks, current_player, per_candidate);
+                });
+            for (auto& t : pool) {
+                t.join();
+            }
+            for (auto& w : workers) {
+                for (auto c : candidates) {
+                    wins[c] += w.win_prob[c];
+                }
+            }
+            for (auto c : candidates) {
+                plays[c] += static_cast<long int>(per_candidate);
+            }
+            std::stable_sort(candidates.begin(), candidates.end(), [&](size_t a, size_t b) {
+                return wins[a] * plays[b] > wins[b] * plays[a];
+                });
+            auto best = InvMapV(candidates[0]);
+            if (!quiet) {
+                std::cout << "halving round " << round << ": " << candidates.size() << " candidates x "
+                    << per_candidate << " playouts, best (" << best[0] << "," << best[1] << ") "
+                    << static_cast<double>(wins[candidates[0]]) / static_cast<double>(plays[candidates[0]])
+                    << "\n";
+            }
+            candidates.resize((candidates.size() + 1) / 2);
+        }
+        for (auto c : blanks) {
+            last_trials += static_cast<size_t>(plays[c]);
+        }
+        return candidates[0];
+    }
+    //-----------------------------------------------------------------------------------------
+    // Playouts of a worker for its share of the candidates, wins of each candidate in win_prob
+    void halving_trials(PlayoutWorker& w, size_t first, size_t stride, const std::vector<size_t>& candidates,
+        const std::vector<size_t>& blanks, const Cell current_player, size_t per_candidate) {
+        w.win_prob.assign(num_vertex, 0);
+        for (size_t i = first; i < candidates.size(); i += stride) {
+            size_t move = candidates[i];
+            // Other blank cells, the opponent moves next and gets the extra one
+            w.Identity.clear();
+            for (auto v : blanks) {
+                if (v != move) {
+                    w.Identity.push_back(v);
+                }
+            }
+            size_t opponent_cells = (w.Identity.size() + 1) / 2;
+            for (size_t trial = 0; trial < per_candidate; ++trial) {
+                shuffle_range(w.Identity.begin(), w.Identity.end(), w.rng);
+                w.fill_red = base_red;
+                if (current_player == red) {
+                    bitboard.set(w.fill_red, move);
+                }
+                for (size_t k = 0; k < w.Identity.size(); ++k) {
+                    if ((k < opponent_cells) != (current_player == red)) {
+                        bitboard.set(w.fill_red, w.Identity[k]);
+                    }
+                }//time complexity is O(n)
+                bool red_wins = bitboard.connects_up_down(w.fill_red, w.reach, w.next);
+                if (red_wins == (current_player == red)) {
+                    w.win_prob[move]++;
+                }
             }
         }
-        return v_sol;
-        //worst case scenario is complexity of order (n^2)
+    }
+    //-----------------------------------------------------------------------------------------
+    // Blank cell with the highest score, used to follow the stability of the best move
+    size_t best_blank(const Counters& scores, size_t count_non_blank) const {
+        size_t best = mapping[count_non_blank];
+        for (size_t map = count_non_blank; map < num_vertex; ++map) {
+            if (scores[mapping[map]] > scores[best]) {
+                best = mapping[map];
+            }
+        }
+        return best;
     }
 //-----------------------------------------------------------------------------------------    
 };
 //=================================================================================================================
+// Range of the table dimension. Memory is linear in the cells (CSR graph, bit and lane
+// tables), so the bound only keeps the terminal display readable enough.
+const int min_dimension = 4;
+const int max_dimension = 128;
+
 int getOnlyNumber1()
 {
     int num;
@@ -682,7 +3875,7 @@ int getOnlyNumber1()
         cout << "Please enter a number :  ";
     }
    
-        while (num > 25 || num < 4) {
+        while (num > max_dimension || num < min_dimension) {
             cout << "please, enter valid number\n";
             while (!(cin >> num)) {
                 // Reset the input:
@@ -697,7 +3890,7 @@ int getOnlyNumber1()
             }
         }
         return num;
-          //time complexity of this following function is O(n^3) but it is better in test case, it limits user to use dimension of [4 to 25] so we will use this implementation in enhancement, next implementation of order O(1)
+          //time complexity of this following function is O(n^3) but it is better in test case, it limits user to use dimension of [min_dimension to max_dimension] so we will use this implementation in enhancement, next implementation of order O(1)
 
     /*
     std::string num1;
@@ -726,29 +3919,985 @@ bool getOnlyNumber2()
 
    
 
+//===========================================================================================
+/*Command line options given as --name value (or --name alone for a flag),
+the other arguments are kept in order as positional arguments.*/
+struct Options {
+    std::vector<std::string> positional;
+    std::unordered_map<std::string, std::string> named;
+
+    Options(int argc, char* argv[]) {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg.size() > 2 && arg.compare(0, 2, "--") == 0) {
+                if (i + 1 < argc && std::string(argv[i + 1]).compare(0, 2, "--") != 0) {
+                    named[arg.substr(2)] = argv[++i];
+                }
+                else {
+                    named[arg.substr(2)] = "1";
+                }
+            }
+            else {
+                positional.push_back(arg);
+            }
+        }
+    }
+
+    inline bool has(const std::string& name) const { return named.count(name) > 0; }
+
+    inline std::string get(const std::string& name, const std::string& def) const {
+        auto it = named.find(name);
+        return it == named.end() ? def : it->second;
+    }
+
+    inline size_t get_size(const std::string& name, const size_t def) const {
+        size_t value = def;
+        if (has(name) && !(std::stringstream(get(name, "")) >> value)) {
+            std::cerr << "Option --" << name << " is not a number -> default value chosen ("
+                << def << ")\n";
+            value = def;
+        }
+        return value;
+    }
+
+    inline double get_double(const std::string& name, const double def) const {
+        double value = def;
+        if (has(name) && !(std::stringstream(get(name, "")) >> value)) {
+            std::cerr << "Option --" << name << " is not a number -> default value chosen ("
+                << def << ")\n";
+            value = def;
+        }
+        return value;
+    }
+};
+//===========================================================================================
+/*Settings of the machine player from the command line, shared by the interactive game
+and the text protocol.*/
+void configure_hex(Hex& hex, const Options& options, const size_t& num_threads, const uint64_t& seed) {
+    Engine engine = engine_from_name(options.get("engine", "flat"));
+    double move_time = options.get_double("move-time", 0.0);
+    double game_time = options.get_double("game-time", 0.0);
+    hex.set_num_threads(num_threads);
+    hex.set_seed(seed);
+    hex.set_engine(engine);
+    hex.set_kernel(kernel_from_name(options.get("kernel", "bitboard")));
+    hex.set_allocation(options.get("allocation", "uniform") == "halving" ? Allocation::Halving
+        : Allocation::Uniform);
+    hex.set_ponder(options.has("ponder"));
+    hex.set_prune(options.has("prune"));
+    hex.set_solver(options.get_size("solve-empties", 0), options.get_size("solve-nodes", 10000000),
+        options.get_double("solve-ms", 0.0), options.get_size("solve-mb", 16));
+    if (move_time > 0) {
+        hex.time_manager().set_move_time(move_time);
+    }
+    else if (game_time > 0) {
+        hex.time_manager().set_game_clock(game_time, options.get_double("inc", 0.0));
+    }
+    hex.tree_search().set_exploration(options.get_double("uct-c", 0.7));
+    hex.tree_search().set_max_nodes(options.get_size("tree-nodes", 4000000));
+    hex.tree_search().transpositions().resize(engine != Engine::Flat ? options.get_size("tt-mb", 64) : 0);
+    hex.tree_search().set_rave(engine == Engine::Rave, options.get_double("rave-k", 1000.0),
+        options.get_size("rave-depth", 3));
+    if (options.has("book") && !hex.load_book(options.get("book", ""))) {
+        std::cerr << "No opening book for this size at " << options.get("book", "") << "\n";
+    }
+}
+//===========================================================================================
+/*Color of the text protocol: black is X (first player, left to right), white is O.*/
+Cell htp_color(std::string name) {
+    std::transform(name.begin(), name.end(), name.begin(),
+        [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (name == "b" || name == "black" || name == "x" || name == "blue") {
+        return Cell::Blue;
+    }
+    if (name == "w" || name == "white" || name == "o" || name == "red") {
+        return Cell::Red;
+    }
+    return Cell::Blank;
+}
+
+/*Headless engine for GUIs and match runners (HTP, the Hex dialect of GTP). One command per
+line on stdin, each answered by "=[id] result" or "?[id] error" and an empty line. Nothing
+else is written on stdout, the board only on showboard.*/
+int run_htp(const Options& options, const size_t& num_threads, const uint64_t& seed, Telemetry& telemetry) {
+    static const std::vector<std::string> commands = { "boardsize", "clear_board", "final_score",
+        "genmove", "known_command", "list_commands", "name", "play", "protocol_version", "quit",
+        "showboard", "time_left", "undo", "version" };
+    size_t size = std::min<size_t>(std::max<size_t>(options.get_size("size", 11), min_dimension), max_dimension);
+    size_t num_trial = std::max<size_t>(options.get_size("trials", 1000), 1);
+    std::unique_ptr<Hex> hex;
+    size_t games = 0;
+    auto new_game = [&]() {
+        hex.reset(new Hex(size));
+        configure_hex(*hex, options, num_threads, seed);
+        hex->set_quiet(true);
+        hex->set_telemetry(&telemetry, games++, options.get("engine", "flat"));
+    };
+    new_game();
+
+    std::string line;
+    bool running = true;
+    while (running && std::getline(std::cin, line)) {
+        // Comments and empty lines get no answer
+        line = line.substr(0, line.find('#'));
+        std::istringstream in(line);
+        std::string id, command;
+        if (!(in >> command)) {
+            continue;
+        }
+        if (std::all_of(command.begin(), command.end(), [](unsigned char c) { return std::isdigit(c); })) {
+            id = command;
+            if (!(in >> command)) {
+                continue;
+            }
+        }
+        std::vector<std::string> args{ std::istream_iterator<std::string>(in),
+            std::istream_iterator<std::string>() };
+        std::string result;
+        bool ok = true;
+        auto fail = [&](const std::string& message) {
+            ok = false;
+            result = message;
+        };
+        Cell player = args.empty() ? Cell::Blank : htp_color(args[0]);
+        bool needs_color = command == "play" || command == "genmove" || command == "time_left";
+
+        if (needs_color && player == Cell::Blank) {
+            fail("invalid color");
+        }
+        else if (command == "name") {
+            result = "HexAI";
+        }
+        else if (command == "version") {
+            result = "1.0";
+        }
+        else if (command == "protocol_version") {
+            result = "2";
+        }
+        else if (command == "list_commands") {
+            for (auto& c : commands) {
+                result += (result.empty() ? "" : "\n") + c;
+            }
+        }
+        else if (command == "known_command") {
+            bool known = !args.empty() && std::find(commands.begin(), commands.end(), args[0]) != commands.end();
+            result = known ? "true" : "false";
+        }
+        else if (command == "boardsize") {
+            size_t n = 0;
+            if (args.empty() || !(std::stringstream(args[0]) >> n)) {
+                fail("syntax error");
+            }
+            else if (n < min_dimension || n > max_dimension || (args.size() > 1 && args[1] != args[0])) {
+                fail("unacceptable size");
+            }
+            else {
+                size = n;
+                new_game();
+            }
+        }
+        else if (command == "clear_board") {
+            new_game();
+        }
+        else if (command == "play") {
+            size_t v = 0;
+            if (args.size() < 2 || !hex->parse_move(args[1], v)) {
+                fail("invalid move");
+            }
+            else if (!hex->place(v, player)) {
+                fail("cell occupied");
+            }
+            else if (hex->has_won(player)) {
+                hex->report_game(player);
+            }
+        }
+        else if (command == "genmove") {
+            if (hex->has_won(Cell::Blue) || hex->has_won(Cell::Red)) {
+                result = "resign";
+            }
+            else {
+                size_t v = hex->think(player, num_trial);
+                hex->place(v, player);
+                result = hex->move_name(v);
+                if (hex->has_won(player)) {
+                    hex->report_game(player);
+                }
+            }
+        }
+        else if (command == "undo") {
+            if (!hex->undo()) {
+                fail("cannot undo");
+            }
+        }
+        else if (command == "showboard") {
+            std::ostringstream board;
+            board << "\n";
+            hex->display_game(board, true);
+            result = board.str();
+            result.pop_back();
+        }
+        else if (command == "time_left") {
+            double seconds = 0.0;
+            if (args.size() < 2 || !(std::stringstream(args[1]) >> seconds)) {
+                fail("syntax error");
+            }
+            else if (hex->time_manager().game_clock()) {
+                hex->time_manager().set_remaining(1000.0 * seconds);
+            }
+            else {
+                // The controller keeps the clock, no increment is assumed
+                hex->time_manager().set_game_clock(1000.0 * seconds, 0.0);
+            }
+        }
+        else if (command == "final_score") {
+            if (hex->has_won(Cell::Blue)) {
+                result = "B+";
+            }
+            else if (hex->has_won(Cell::Red)) {
+                result = "W+";
+            }
+            else {
+                fail("game not over");
+            }
+        }
+        else if (command == "quit") {
+            running = false;
+        }
+        else {
+            fail("unknown command");
+        }
+        std::cout << (ok ? "=" : "?") << id << (result.empty() ? "" : " " + result) << "\n\n" << std::flush;
+    }
+    return 0;
+}
+/*Microbenchmarks of the pieces of one move, each timed alone: Hex construction (hex_graph
+and the border tables), UnionFind on random full tables, one MonteCarlo call on the empty
+table and display_game, at the usual table sizes and one large table.*/
+int run_microbench(const Options& options, const size_t& num_threads) {
+    size_t num_trial = std::max<size_t>(options.get_size("trials", 1000), 1);
+    std::cout << "size  construction(us)  UnionFind(ns)  MonteCarlo(ms)  playouts/s  display_game(us)\n";
+    for (size_t size : { 5, 7, 11, 13, 19, 25, 64 }) {
+        const size_t repeats = 20;
+        auto t0 = steady_clock::now();
+        for (size_t r = 0; r < repeats; ++r) {
+            Hex built(size);
+        }
+        double construction = duration<double, std::micro>(steady_clock::now() - t0).count() / repeats;
+
+        Hex hex(size);
+        hex.set_num_threads(num_threads);
+        hex.set_seed(1);
+        hex.set_quiet(true);
+        double union_find = hex.benchmark_union_find(2000);
+
+        t0 = steady_clock::now();
+        hex.think(Cell::Blue, num_trial);
+        double search = duration<double, std::milli>(steady_clock::now() - t0).count();
+        double pps = static_cast<double>(hex.last_playouts()) / (search / 1000.0);
+
+        std::ostringstream sink;
+        t0 = steady_clock::now();
+        for (size_t r = 0; r < repeats; ++r) {
+            hex.display_game(sink);
+        }
+        double display = duration<double, std::micro>(steady_clock::now() - t0).count() / repeats;
+
+        std::cout << size << "\t" << construction << "\t\t" << union_find << "\t\t" << search
+            << "\t\t" << pps << "\t" << display << "\n";
+    }//time complexity=O(n^2) per size
+    return 0;
+}
+
+/*Self-check of the playout kernels: random full tables at the sizes with specialized
+kernels, some generic sizes and tables over 32 columns, decided by the bitboard, sliced and
+bridge kernels and by UnionFind. Exits with 1 on any disagreement.*/
+int run_selftest(const Options& options, const uint64_t& seed) {
+    size_t num_batches = std::max<size_t>(options.get_size("trials", 6400) / 64, 1);
+    size_t failures = 0;
+    for (size_t size : { 2, 4, 5, 7, 8, 9, 11, 13, 19, 25, 40, 64 }) {
+        Hex hex(size);
+        hex.set_seed(seed + size);
+        auto errors = hex.check_kernels(num_batches);
+        std::cout << "size " << size << ", " << 64 * num_batches << " tables, " << num_batches << " bridge games:";
+        for (Kernel k : { Kernel::Bitboard, Kernel::Sliced, Kernel::Bridges }) {
+            size_t e = errors[static_cast<size_t>(k)];
+            std::cout << " " << kernel_name(k) << " " << (e ? std::to_string(e) + " errors" : "ok");
+            failures += e;
+        }
+        std::cout << "\n";
+    }//time complexity=O(n^2) per table
+    std::cout << "selftest: " << (failures ? "FAILED" : "passed") << " (seed " << seed << ")\n";
+    return failures ? 1 : 0;
+}
+
+/*Fixed workload for regression tracking: the empty table and one table with scattered stones
+at four sizes, searched with the engine options and a fixed seed. The total playouts per
+second is the number to compare between builds.*/
+int run_bench(const Options& options, const size_t& num_threads) {
+    uint64_t seed = options.get_size("seed", 1);
+    size_t num_trial = std::max<size_t>(options.get_size("trials", 20000), 1);
+    size_t total_playouts = 0;
+    double total_ms = 0.0;
+    for (size_t size : { 7, 11, 13, 19 }) {
+        for (size_t stones : { size_t(0), size }) {
+            Hex hex(size);
+            configure_hex(hex, options, num_threads, seed);
+            hex.set_quiet(true);
+            // The same stones on every run
+            Rng position(size * 1000 + stones);
+            while (hex.moves_played() < stones) {
+                size_t v = position.bounded(static_cast<uint32_t>(size * size));
+                hex.place(v, hex.to_move());
+            }
+            auto t0 = steady_clock::now();
+            size_t move = hex.think(hex.to_move(), num_trial);
+            double ms = duration<double, std::milli>(steady_clock::now() - t0).count();
+            total_playouts += hex.last_playouts();
+            total_ms += ms;
+            std::cout << "size " << size << ", " << stones << " stones: move " << hex.move_name(move)
+                << ", " << hex.last_playouts() << " playouts, " << ms << " ms\n";
+        }
+    }//time complexity=O(n)
+    std::cout << "bench: " << total_playouts << " playouts, " << total_ms << " ms, "
+        << static_cast<size_t>(static_cast<double>(total_playouts) / (total_ms / 1000.0))
+        << " playouts/s\n";
+    return 0;
+}
+
+/*Offline builder of the opening book of one table size: every position of the first plies
+is searched with the engine options and a large budget, the best move and its value are
+stored under the canonical key shared by the position and its 180 degree rotation.*/
+class BookBuilder {
+public:
+    BookBuilder(const Options& options, const size_t& num_threads, const uint64_t& seed)
+        : hex(std::min<size_t>(std::max<size_t>(book_size(options), min_dimension), max_dimension)) {
+        Options engine_options = options;
+        engine_options.named.erase("book");
+        configure_hex(hex, engine_options, num_threads, seed);
+        hex.set_quiet(true);
+        plies = options.get_size("book-plies", 2);
+        num_trial = std::max<size_t>(options.get_size("trials", 100000), 1);
+    }
+
+    int run(std::string path) {
+        size_t size = hex.dimension();
+        size_t at = path.find("{size}");
+        if (at != std::string::npos) {
+            path.replace(at, 6, std::to_string(size));
+        }
+        start = steady_clock::now();
+        visit();
+        if (!OpeningBook::write(path, size, entries)) {
+            std::cerr << "Cannot write " << path << "\n";
+            return 1;
+        }
+        std::cout << "book: " << entries.size() << " positions of size " << size << " up to ply " << plies
+            << " written to " << path << "\n";
+        return 0;
+    }
+
+    static size_t book_size(const Options& options) {
+        return options.positional.size() >= 2 ? static_cast<size_t>(atoi(options.positional[1].c_str()))
+            : options.get_size("size", 11);
+    }
+
+private:
+    Hex hex;
+    size_t plies;
+    size_t num_trial;
+    std::vector<OpeningBook::Entry> entries;
+    std::unordered_set<uint64_t> seen;
+    steady_clock::time_point start;
+
+    /*Searches the current position, then every reply while the ply limit allows.*/
+    void visit() {
+        Cell player = hex.to_move();
+        bool rotated;
+        uint64_t key = hex.book_key(player, rotated);
+        if (!seen.insert(key).second) {
+            return;
+        }
+        size_t move = hex.think(player, num_trial);
+        float value = static_cast<float>(hex.move_value(player, move));
+        entries.push_back(OpeningBook::Entry{ key, static_cast<uint32_t>(rotated ? hex.rotate(move) : move), value });
+        if (entries.size() % 100 == 0) {
+            std::cout << entries.size() << " positions, "
+                << duration<double>(steady_clock::now() - start).count() << " s\n";
+        }
+        if (hex.moves_played() >= plies) {
+            return;
+        }
+        for (size_t v = 0; v < hex.dimension() * hex.dimension(); ++v) {
+            if (hex.is_blank(v)) {
+                hex.place(v, player);
+                visit();
+                hex.undo();
+            }
+        }//time complexity=O(n^plies)
+    }
+};
+//===========================================================================================
+/*Table written as its rows, '.' blank, 'X' and 'O' stones, the rows may be separated by '/'.
+False unless there are N*N cells with N from 2 to max_dimension.*/
+bool parse_position(const std::string& text, std::vector<Cell>& stones, size_t& size) {
+    stones.clear();
+    for (char c : text) {
+        c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        if (c == '.' || c == 'X' || c == 'O') {
+            stones.push_back(c == 'X' ? Cell::Blue : c == 'O' ? Cell::Red : Cell::Blank);
+        }
+        else if (c != '/' && !std::isspace(static_cast<unsigned char>(c))) {
+            return false;
+        }
+    }//time complexity=O(n)
+    size = static_cast<size_t>(std::lround(std::sqrt(static_cast<double>(stones.size()))));
+    return size * size == stones.size() && size >= 2 && size <= static_cast<size_t>(max_dimension);
+}
+
+// Player to move of a parsed table: the one with fewer stones, X on a tie
+Cell default_mover(const std::vector<Cell>& stones) {
+    auto x = std::count(stones.begin(), stones.end(), Cell::Blue);
+    auto o = std::count(stones.begin(), stones.end(), Cell::Red);
+    return x > o ? Cell::Red : Cell::Blue;
+}
+
+// Stones of a parsed table on an empty hex of the same size
+void place_stones(Hex& hex, const std::vector<Cell>& stones) {
+    for (size_t v = 0; v < stones.size(); ++v) {
+        if (stones[v] != Cell::Blank) {
+            hex.place(v, stones[v]);
+        }
+    }//time complexity=O(n)
+}
+
+/*Solves one position given as the rows of the table, the player to move is given by
+--to-move or else by default_mover. Prints the outcome, the winning move, the nodes and
+nodes/s.*/
+int run_solve(const Options& options, const size_t& num_threads) {
+    std::string position;
+    for (size_t i = 1; i < options.positional.size(); ++i) {
+        position += options.positional[i];
+    }//time complexity=O(n)
+    std::vector<Cell> stones;
+    size_t size = 0;
+    if (!parse_position(position, stones, size)) {
+        std::cerr << "solve: the position needs N*N cells of . X O, got " << stones.size() << "\n";
+        return 1;
+    }
+    Hex hex(size);
+    configure_hex(hex, options, num_threads, 1);
+    hex.set_quiet(true);
+    place_stones(hex, stones);
+    Cell player = options.has("to-move") ? htp_color(options.get("to-move", "x")) : default_mover(stones);
+    if (player == Cell::Blank) {
+        std::cerr << "solve: --to-move takes x or o\n";
+        return 1;
+    }
+    Solver::Result result = hex.solve(player);
+    std::string name = player == Cell::Blue ? "X" : "O";
+    if (result.proof == Proof::Win) {
+        std::cout << name << " to move wins" << (result.move < size * size ? " with " + hex.move_name(result.move) : "") << "\n";
+    }
+    else if (result.proof == Proof::Loss) {
+        std::cout << name << " to move loses\n";
+    }
+    else {
+        std::cout << "unknown, the node or time budget ran out\n";
+    }
+    std::cout << "nodes " << result.nodes << ", " << result.ms << " ms, "
+        << static_cast<size_t>(result.ms > 0 ? 1000.0 * static_cast<double>(result.nodes) / result.ms : 0.0)
+        << " nodes/s\n";
+    return result.proof == Proof::Unknown ? 2 : 0;
+}
+//===========================================================================================
+/*Options of one side of a match: --a-trials 2000 overrides --trials for engine a only.*/
+Options side_options(const Options& options, const std::string& side) {
+    Options result = options;
+    std::string prefix = side + "-";
+    for (auto& entry : options.named) {
+        if (entry.first.compare(0, prefix.size(), prefix) == 0) {
+            result.named[entry.first.substr(prefix.size())] = entry.second;
+        }
+    }//time complexity=O(n)
+    return result;
+}
+
+/*Options of the engines that run many at once, match games and analyzer workers: their
+tree search tables default to 4 MB each instead of 64, --tt-mb still sets them.*/
+Options pooled_options(Options options) {
+    if (!options.has("tt-mb")) {
+        options.named["tt-mb"] = "4";
+    }
+    return options;
+}
+//===========================================================================================
+/*MatchRunner class plays games between two engine configurations a and b, several games at
+once on a pool of threads. Games come in pairs: both games of a pair start with the same
+random X stone and the engines swap colors, so neither side profits from a lucky opening.
+Each engine keeps its own Hex table and both tables receive every move, the winner is
+decided by the Hex stone sets. The score gives the Elo difference of a over b with a 95%
+interval, and with --sprt the match stops once the sequential probability ratio test
+accepts elo0 (no gain) or elo1 (gain) at the error rates alpha and beta.*/
+class MatchRunner {
+public:
+    MatchRunner(const Options& options, const uint64_t& seed_value, Telemetry& t)
+        : side_a(pooled_options(side_options(options, "a"))), side_b(pooled_options(side_options(options, "b"))),
+        seed(seed_value), telemetry(t) {
+        size = std::min<size_t>(std::max<size_t>(options.get_size("size", 7), min_dimension), max_dimension);
+        num_games = options.get_size("games", 100);
+        concurrency = std::max<size_t>(options.get_size("concurrency",
+            std::max<unsigned>(1, std::thread::hardware_concurrency())), 1);
+        sprt = options.has("sprt");
+        elo0 = options.get_double("elo0", 0.0);
+        elo1 = options.get_double("elo1", 30.0);
+        double alpha = options.get_double("alpha", 0.05);
+        double beta = options.get_double("beta", 0.05);
+        lower_bound = std::log(beta / (1.0 - alpha));
+        upper_bound = std::log((1.0 - beta) / alpha);
+    }
+
+    int run() {
+        std::cout << "match " << describe(side_a) << " vs " << describe(side_b) << ", size " << size
+            << ", " << num_games << " games, " << concurrency << " at once, seed " << seed << "\n";
+        std::atomic<size_t> next_game{ 0 };
+        std::vector<std::thread> pool;
+        for (size_t t = 0; t < concurrency; ++t) {
+            pool.emplace_back([this, &next_game]() {
+                for (;;) {
+                    size_t game = next_game++;
+                    if (game >= num_games || stopped) {
+                        return;
+                    }
+                    bool a_blue = game % 2 == 0;
+                    bool a_won = play_game(game, a_blue);
+                    record(game, a_blue, a_won);
+                }
+                });
+        }//time complexity=O(n)
+        for (auto& t : pool) {
+            t.join();
+        }
+        size_t games = wins_a + wins_b;
+        double score = games ? static_cast<double>(wins_a) / static_cast<double>(games) : 0.5;
+        std::cout << "result: a " << wins_a << " - b " << wins_b << ", a scores "
+            << 100.0 * score << "%, Elo " << elo(score);
+        auto interval = elo_interval(score, games);
+        std::cout << " [" << interval.first << ", " << interval.second << "]\n";
+        if (sprt) {
+            std::cout << "SPRT elo0 " << elo0 << " elo1 " << elo1 << ": LLR " << llr()
+                << " [" << lower_bound << ", " << upper_bound << "] "
+                << (verdict.empty() ? "inconclusive" : verdict) << "\n";
+        }
+        return 0;
+    }
+
+private:
+    Options side_a;
+    Options side_b;
+    uint64_t seed;
+    Telemetry& telemetry;
+    size_t size;
+    size_t num_games;
+    size_t concurrency;
+    bool sprt;
+    double elo0;
+    double elo1;
+    double lower_bound;
+    double upper_bound;
+    // Results, guarded by lock
+    std::mutex lock;
+    size_t wins_a = 0;
+    size_t wins_b = 0;
+    std::string verdict;
+    std::atomic<bool> stopped{ false };
+
+    static std::string describe(const Options& side) {
+        std::ostringstream text;
+        text << side.get("engine", "flat") << "/" << side.get_size("trials", 1000) << "/"
+            << side.get_size("threads", 1) << "t";
+        return text.str();
+    }
+
+    /*Elo difference of a score, clamped away from 0 and 1.*/
+    static double elo(double score) {
+        score = std::min(std::max(score, 1e-3), 1.0 - 1e-3);
+        return -400.0 * std::log10(1.0 / score - 1.0);
+    }
+
+    /*95% interval of the Elo difference: the Wilson score interval of the score, which
+    keeps a width at scores 0 and 1, converted by elo().*/
+    static std::pair<double, double> elo_interval(const double& score, const size_t& games) {
+        if (games == 0) {
+            return { elo(0.0), elo(1.0) };
+        }
+        const double z = 1.96, n = static_cast<double>(games);
+        double centre = (score + z * z / (2.0 * n)) / (1.0 + z * z / n);
+        double margin = z / (1.0 + z * z / n) * std::sqrt(score * (1.0 - score) / n + z * z / (4.0 * n * n));
+        return { elo(centre - margin), elo(centre + margin) };
+    }
+
+    // Log likelihood ratio of elo1 against elo0, Hex games have no draws
+    double llr() const {
+        double p0 = 1.0 / (1.0 + std::pow(10.0, -elo0 / 400.0));
+        double p1 = 1.0 / (1.0 + std::pow(10.0, -elo1 / 400.0));
+        return static_cast<double>(wins_a) * std::log(p1 / p0)
+            + static_cast<double>(wins_b) * std::log((1.0 - p1) / (1.0 - p0));
+    }
+
+    /*One game, a_blue tells whether engine a plays X. Returns true when a wins.*/
+    bool play_game(const size_t& game, const bool& a_blue) {
+        Hex a(size), b(size);
+        Rng seeds(seed ^ (0x9E3779B97F4A7C15ULL * (game + 1)));
+        configure_hex(a, side_a, side_a.get_size("threads", 1), seeds());
+        configure_hex(b, side_b, side_b.get_size("threads", 1), seeds());
+        a.set_quiet(true);
+        b.set_quiet(true);
+        a.set_telemetry(&telemetry, game, "a");
+        b.set_telemetry(&telemetry, game, "b");
+        // Same opening for both games of a pair
+        Rng opening(seed ^ (0xD1B54A32D192ED03ULL * (game / 2 + 1)));
+        size_t v = opening.bounded(static_cast<uint32_t>(size * size));
+        std::array<Hex*, 2> players = { { a_blue ? &a : &b, a_blue ? &b : &a } };
+        std::array<size_t, 2> trials = { { (a_blue ? side_a : side_b).get_size("trials", 1000),
+            (a_blue ? side_b : side_a).get_size("trials", 1000) } };
+        Cell player = Cell::Blue;
+        for (size_t it = 0; it < size * size; ++it) {
+            if (it > 0) {
+                v = players[it % 2]->think(player, trials[it % 2]);
+            }
+            a.place(v, player);
+            b.place(v, player);
+            if (a.has_won(player)) {
+                a.report_game(player);
+                return (player == Cell::Blue) == a_blue;
+            }
+            player = opponent(player);
+        }//time complexity=O(n^2) moves
+        // A full table always has a winner
+        return false;
+    }
+
+    void record(const size_t& game, const bool& a_blue, const bool& a_won) {
+        std::lock_guard<std::mutex> guard(lock);
+        (a_won ? wins_a : wins_b)++;
+        size_t games = wins_a + wins_b;
+        double score = static_cast<double>(wins_a) / static_cast<double>(games);
+        std::cout << "game " << game + 1 << ": " << (a_won ? "a" : "b") << " wins as "
+            << (a_won == a_blue ? "X" : "O") << ", a " << wins_a << " - b " << wins_b
+            << ", Elo " << elo(score);
+        auto interval = elo_interval(score, games);
+        std::cout << " [" << interval.first << ", " << interval.second << "]";
+        if (sprt) {
+            double ratio = llr();
+            std::cout << ", LLR " << ratio;
+            if (verdict.empty() && (ratio <= lower_bound || ratio >= upper_bound)) {
+                verdict = ratio >= upper_bound ? "H1 accepted (a is stronger)" : "H0 accepted (no gain)";
+                stopped = true;
+            }
+        }
+        std::cout << "\n" << std::flush;
+    }
+};
+//===========================================================================================
+/*BatchAnalyzer class evaluates a stream of positions, one per line: the rows of the table
+as for solve, then optionally the player to move (x or o); empty lines and '#' comments are
+skipped. A pool of workers searches the positions with the engine options, each worker
+reusing its Hex while the size does not change, its tree and tables cleared before every
+line, and the results are written as JSON lines
+in input order: best move, its value and the value of every cell (null for stones and
+cells without statistics). At most window lines are in flight, so memory stays bounded
+however long the input is: the reader waits for the oldest line to be written before
+taking a new one. The seed of a line is the seed plus its line number, so the results do
+not depend on the number of workers.*/
+class BatchAnalyzer {
+public:
+    BatchAnalyzer(const Options& options_value, const uint64_t& seed_value)
+        : options(pooled_options(options_value)), seed(seed_value) {
+        num_workers = std::max<size_t>(options.get_size("workers",
+            std::max<unsigned>(1, std::thread::hardware_concurrency())), 1);
+        window = std::max<size_t>(options.get_size("window", 4 * num_workers), 1);
+        num_trial = std::max<size_t>(options.get_size("trials", 1000), 1);
+        // Parallelism comes from the positions, one thread per search by default
+        search_threads = options.get_size("threads", 1);
+        slots.resize(window);
+    }
+
+    int run(std::istream& in, std::ostream& out) {
+        auto t0 = steady_clock::now();
+        output = &out;
+        std::vector<std::thread> pool;
+        for (size_t w = 0; w < num_workers; ++w) {
+            pool.emplace_back([this]() { work(); });
+        }//time complexity=O(n)
+        std::string line;
+        size_t line_number = 0;
+        while (std::getline(in, line)) {
+            ++line_number;
+            line = line.substr(0, line.find('#'));
+            if (line.find_first_not_of(" \t\r") == std::string::npos) {
+                continue;
+            }
+            std::unique_lock<std::mutex> guard(lock);
+            // The slot of this sequence number is free once the line window before it is written
+            space.wait(guard, [&]() { return read - written < window; });
+            Slot& slot = slots[read % window];
+            slot.line = line_number;
+            slot.text = std::move(line);
+            slot.done = false;
+            pending.push(read++);
+            work_ready.notify_one();
+        }//time complexity=O(n)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            finished = true;
+        }
+        work_ready.notify_all();
+        for (auto& t : pool) {
+            t.join();
+        }
+        double seconds = duration<double>(steady_clock::now() - t0).count();
+        std::cerr << "analyze: " << written << " positions, " << seconds << " s, "
+            << (seconds > 0 ? static_cast<double>(written) / seconds : 0.0) << " positions/s, "
+            << num_workers << " workers\n";
+        return 0;
+    }
+
+private:
+    struct Slot {
+        size_t line = 0;
+        std::string text;
+        std::string result;
+        bool done = false;
+    };
+
+    Options options;
+    uint64_t seed;
+    size_t num_workers;
+    size_t window;
+    size_t num_trial;
+    size_t search_threads;
+    std::ostream* output = nullptr;
+    // Lines read, sequence numbers waiting for a worker and lines written, guarded by lock
+    std::mutex lock;
+    std::condition_variable space;
+    std::condition_variable work_ready;
+    std::vector<Slot> slots;
+    std::queue<size_t> pending;
+    size_t read = 0;
+    size_t written = 0;
+    bool finished = false;
+
+    void work() {
+        std::unique_ptr<Hex> hex;
+        for (;;) {
+            size_t sequence;
+            std::string text;
+            size_t line;
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                work_ready.wait(guard, [&]() { return !pending.empty() || finished; });
+                if (pending.empty()) {
+                    return;
+                }
+                sequence = pending.front();
+                pending.pop();
+                text = slots[sequence % window].text;
+                line = slots[sequence % window].line;
+            }
+            std::string result = analyze(hex, line, text);
+            std::lock_guard<std::mutex> guard(lock);
+            Slot& slot = slots[sequence % window];
+            slot.result = std::move(result);
+            slot.done = true;
+            // Writes every finished line that has no unfinished line before it
+            while (written < read && slots[written % window].done) {
+                Slot& next = slots[written % window];
+                *output << next.result;
+                next.done = false;
+                next.text.clear();
+                next.result.clear();
+                ++written;
+            }
+            output->flush();
+            space.notify_one();
+        }
+    }
+
+    /*JSON line of one position, searched on hex which is created or cleared for it.*/
+    std::string analyze(std::unique_ptr<Hex>& hex, const size_t& line, const std::string& text) {
+        std::ostringstream json;
+        json << "{\"line\":" << line;
+        std::istringstream fields(text);
+        std::string rows, mover;
+        fields >> rows >> mover;
+        std::vector<Cell> stones;
+        size_t size = 0;
+        if (!parse_position(rows, stones, size)) {
+            json << ",\"error\":\"the position needs N*N cells of . X O\"}\n";
+            return json.str();
+        }
+        Cell player = mover.empty() ? default_mover(stones) : htp_color(mover);
+        if (player == Cell::Blank) {
+            json << ",\"error\":\"the player to move is x or o\"}\n";
+            return json.str();
+        }
+        if (!hex || hex->dimension() != size) {
+            hex.reset(new Hex(size));
+            configure_hex(*hex, options, search_threads, seed);
+            hex->set_quiet(true);
+        }
+        while (hex->undo()) {
+        }//time complexity=O(n^2)
+        hex->forget_searches();
+        hex->set_seed(seed + line);
+        place_stones(*hex, stones);
+        json << ",\"size\":" << size << ",\"to_move\":\"" << (player == Cell::Blue ? "X" : "O") << "\"";
+        if (hex->has_won(Cell::Blue) || hex->has_won(Cell::Red)) {
+            json << ",\"winner\":\"" << (hex->has_won(Cell::Blue) ? "X" : "O") << "\"}\n";
+            return json.str();
+        }
+        size_t move = hex->think(player, num_trial);
+        const SearchStats& stats = hex->last_search();
+        std::vector<double> values(size * size, -1.0);
+        if (stats.proof == Proof::Win) {
+            values[move] = 1.0;
+        }
+        else {
+            for (auto& entry : hex->move_values(player)) {
+                values[entry.first] = entry.second;
+            }
+        }
+        json << ",\"move\":\"" << hex->move_name(move) << "\",\"value\":" << std::max(values[move], 0.0)
+            << ",\"playouts\":" << stats.playouts << ",\"time_ms\":" << stats.time_ms << ",\"win_prob\":[";
+        for (size_t v = 0; v < values.size(); ++v) {
+            json << (v ? "," : "");
+            if (values[v] < 0) {
+                json << "null";
+            }
+            else {
+                json << values[v];
+            }
+        }//time complexity=O(n)
+        json << "]}\n";
+        return json.str();
+    }
+};
 //===========================================================================================
 int main(int argc, char* argv[]) {
+    Options options(argc, argv);
+    // Hardware concurrency may be unknown (0)
+    size_t num_threads = options.get_size("threads",
+        std::max<unsigned>(1, std::thread::hardware_concurrency()));
+    std::random_device rd;
+    uint64_t seed = options.get_size("seed", (uint64_t(rd()) << 32) | rd());
+    Engine engine = engine_from_name(options.get("engine", "flat"));
+    double move_time = options.get_double("move-time", 0.0);
+    double game_time = options.get_double("game-time", 0.0);
+    bool timed = move_time > 0 || game_time > 0;
+    Telemetry telemetry;
+    if (options.has("telemetry")) {
+        // A bare --telemetry writes to stderr
+        std::string target = options.get("telemetry", "1");
+        if (!telemetry.open(target == "1" ? "stderr" : target)) {
+            std::cerr << "Cannot open telemetry file " << target << "\n";
+        }
+    }
+    telemetry.set_top(options.get_size("telemetry-top", 5));
+
+    // ./HexAI htp [--size N] [--trials N], reads commands on stdin
+    if (!options.positional.empty() && options.positional[0] == "htp") {
+        return run_htp(options, num_threads, seed, telemetry);
+    }
+
+    // ./HexAI match --games N --size S --a-trials N --b-engine mcts ...
+    if (!options.positional.empty() && options.positional[0] == "match") {
+        MatchRunner match(options, seed, telemetry);
+        return match.run();
+    }
+
+    // ./HexAI bench [--trials N] [--seed S], ./HexAI microbench [--trials N]
+    if (!options.positional.empty() && options.positional[0] == "bench") {
+        return run_bench(options, num_threads);
+    }
+    if (!options.positional.empty() && options.positional[0] == "microbench") {
+        return run_microbench(options, num_threads);
+    }
+
+    // ./HexAI selftest [--trials N] [--seed S], exit status 1 when a kernel disagrees
+    if (!options.positional.empty() && options.positional[0] == "selftest") {
+        return run_selftest(options, seed);
+    }
 
+    // ./HexAI analyze FILE|- [--workers N] [--window W] [--trials N], JSON lines on stdout
+    if (!options.positional.empty() && options.positional[0] == "analyze") {
+        std::string source = options.positional.size() >= 2 ? options.positional[1] : "-";
+        BatchAnalyzer analyzer(options, options.get_size("seed", 1));
+        if (source == "-") {
+            return analyzer.run(std::cin, std::cout);
+        }
+        std::ifstream file(source);
+        if (!file) {
+            std::cerr << "Cannot open " << source << "\n";
+            return 1;
+        }
+        return analyzer.run(file, std::cout);
+    }
+
+    // ./HexAI solve POSITION [--to-move x|o] [--solve-nodes N] [--solve-ms MS] [--solve-mb MB]
+    if (!options.positional.empty() && options.positional[0] == "solve") {
+        return run_solve(options, num_threads);
+    }
+
+    // ./HexAI build-book dimension [--book FILE] [--book-plies P] [--trials N]
+    if (!options.positional.empty() && options.positional[0] == "build-book") {
+        BookBuilder builder(options, num_threads, seed);
+        return builder.run(options.get("book", "hexbook{size}.bin"));
+    }
+
+    // ./HexAI bench-playouts dimension playouts
+    if (!options.positional.empty() && options.positional[0] == "bench-playouts") {
+        size_t dim = options.positional.size() >= 2 ? static_cast<size_t>(atoi(options.positional[1].c_str())) : 11;
+        size_t playouts = options.positional.size() >= 3 ? static_cast<size_t>(atoi(options.positional[2].c_str())) : 100000;
+        Hex bench(std::max<size_t>(dim, 2));
+        bench.set_num_threads(num_threads);
+        bench.set_seed(seed);
+        bench.benchmark_playouts(std::max<size_t>(playouts, 1));
+        return 0;
+    }
+
+    // Every prompt is skipped when its answer is on the command line
     int num_rows = 0;
     std::cout << "welcome to HEX-game\n";
-    std::cout << "please enter number of rows you prefer to play of range[4-25]\n";
-    num_rows = getOnlyNumber1();
+    if (options.has("size") || !options.positional.empty()) {
+        num_rows = options.has("size") ? static_cast<int>(options.get_size("size", 11))
+            : atoi(options.positional[0].c_str());
+        if (num_rows < min_dimension || num_rows > max_dimension) {
+            num_rows = std::min(std::max(num_rows, min_dimension), max_dimension);
+            std::cout << "Dimension out of range -> " << num_rows << " chosen\n";
+        }
+    }
+    else {
+        std::cout << "please enter number of rows you prefer to play of range[" << min_dimension
+            << "-" << max_dimension << "]\n";
+        num_rows = getOnlyNumber1();
+    }
 
     int HumanVsHuman;
-    std::cout << "for [human vs machine] enter 0\n";
-    std::cout << "for [human vs human] enter any other Input\n";
-    HumanVsHuman = getOnlyNumber2();
+    if (options.positional.size() >= 2) {
+        HumanVsHuman = atoi(options.positional[1].c_str());
+    }
+    else if (options.has("size")) {
+        HumanVsHuman = options.has("human-vs-human");
+    }
+    else {
+        std::cout << "for [human vs machine] enter 0\n";
+        std::cout << "for [human vs human] enter any other Input\n";
+        HumanVsHuman = getOnlyNumber2();
+    }
     double num_trial = 1000.0;
 
     std::cout
         << "note: Player should hit row number+enter button, then column+enter.\n\n";
-    if (argc == 2) {
-        num_rows = atoi(argv[1]);
-    }
-    else if (argc == 3) {
-        num_rows = atoi(argv[1]);
-        HumanVsHuman = atoi(argv[2]);
-    }
     std::cout << "Hex dimension " << num_rows << "\n";
     if (HumanVsHuman) {
         std::cout << "Human Vs Human \n\n";
@@ -761,25 +4910,51 @@ int main(int argc, char* argv[]) {
     std::cout << "Second player is O \n\n";
     std::string Input = "";
     std::string num_MCS;
-    if (!HumanVsHuman) {
+    if (!HumanVsHuman && options.has("player")) {
+        Input = options.get("player", "o");
+    }
+    else if (!HumanVsHuman) {
         std::cout
             << "for X Please enter \'x\' or \'X\' , for O enter \'O\' or any other input "
             << "\n";
         std::cin >> Input;
-        std::cout << "Please enter number of montecarlo simulations (min=100, "
-            "default=1000)\n";
+    }
+    if (!HumanVsHuman && timed) {
+        if (move_time > 0) {
+            std::cout << "Machine thinks " << move_time << " ms per move\n";
+        }
+        else {
+            std::cout << "Machine game clock " << game_time << " ms + "
+                << options.get_double("inc", 0.0) << " ms per move\n";
+        }
+    }
+    else if (!HumanVsHuman) {
+        if (options.has("trials")) {
+            num_trial = options.get_double("trials", 1000.0);
+        }
+        else {
+            std::cout << "Please enter number of montecarlo simulations (min=100, "
+                "default=1000)\n";
 
-        std::cin >> num_MCS;
+            std::cin >> num_MCS;
 
-        if (!(std::stringstream(num_MCS) >> num_trial)) {
-            num_trial = 1000.0;
-            std::cout << "Not a number -> default value chosen (1000)\n";
+            if (!(std::stringstream(num_MCS) >> num_trial)) {
+                num_trial = 1000.0;
+                std::cout << "Not a number -> default value chosen (1000)\n";
+            }
         }
 
         num_trial = std::max(100.0, num_trial);
         std::cout << "User has chosen " << num_trial << " Monte Carlo simulation\n";
     }
+    if (!HumanVsHuman) {
+        std::cout << "Machine uses " << engine_name(engine)
+            << ", " << num_threads << " threads, seed " << seed
+            << " (replay with --seed " << seed << ")\n";
+    }
     Hex ST(num_rows, HumanVsHuman);
+    configure_hex(ST, options, num_threads, seed);
+    ST.set_telemetry(&telemetry, 0, engine_name(engine));
     // ST.print_hex_graph();
     // Play while non game over
     while (!ST.game_over(Input, static_cast<size_t>(num_trial)))